@@ -0,0 +1,168 @@
+/**
+ * @file fog_stamp.cpp
+ * @brief Cost of uncovering the fog of war along the track segments, by the grid resolution
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: fog_stamp [points]
+ *
+ * First the cells stamped by fog_grid::segment() and the discs of its ends are checked against
+ * the distance to the segment, on random segments of a small grid. Then the synthetic walk, 200k
+ * points by default, is stamped as stamp_fog_grid() does at each resolution from 128 to 2048: a
+ * disc on each cell not yet claimed and a segment from the previous point, but for the jumps.
+ * The walk is sampled once a step, then once every 10 and 100 steps, as a longer update period
+ * would, for longer segments. The discs and the segments are timed apart.
+ *
+ * This file builds src/render.cpp as its own part, to reach its fog grid.
+ */
+
+#include "render.cpp"
+
+#include "walk.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock clock;
+
+double
+since (clock::time_point a)
+{
+    return std::chrono::duration<double> (clock::now () - a).count ();
+}
+
+float
+segment_distance (glm::vec2 const& p, glm::vec2 const& a, glm::vec2 const& b)
+{
+    auto const ab = b - a;
+    float const l2 = glm::dot (ab, ab);
+    float const t = l2 > 0 ? glm::clamp (glm::dot (p - a, ab) / l2, 0.f, 1.f) : 0.f;
+    return glm::length (p - (a + t * ab));
+}
+
+/// Cells missed closer than the radius to random segments, and cells stamped farther than it
+std::pair<int, int>
+check_coverage ()
+{
+    int missing = 0, extra = 0;
+    constexpr int res = 64;
+    for (int r: { 1, 2, 4, 8 })
+    {
+        std::mt19937 rng (r);
+        std::uniform_int_distribution<int> c (-8, res + 8);
+        fog_grid g;
+        for (int k = 0; k < 2000; ++k)
+        {
+            g.reset (res, r, 255, 128, 0, 1e9f, 0);
+            glm::ivec2 const a (c (rng), c (rng)), b (c (rng), c (rng));
+            g.disc (a, 0, res);
+            g.disc (b, 0, res);
+            g.segment (a, b, 0, res);
+            for (int y = 0; y < res; ++y)
+                for (int x = 0; x < res; ++x)
+                {
+                    float const d = segment_distance (glm::vec2 (x, y), a, b);
+                    bool const on = g.cells[x + y * res] == 128;
+                    missing += !on && d < r - 1e-3f;
+                    extra += on && d >= r + 1e-3f;
+                }
+        }
+    }
+    return { missing, extra };
+}
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::size_t const n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 200'000;
+
+    auto const [missing, extra] = bench::check_coverage ();
+    std::printf ("== coverage of 8000 random segments: %d cells missed, %d stamped too far\n",
+                 missing, extra);
+
+    // The default map of fileio.cpp and the default discover radius of the settings
+    maptrack.offset = { .4766f, .3760f };
+    maptrack.scale = { 1.f/(2048*205), 1.f/(2048*205) };
+    constexpr int discover = 4;
+
+    bench::walk w;
+    std::vector<glm::vec2> path (n);
+    for (auto& p: path)
+        p = glm::vec2 (w.step ());
+
+    std::printf ("== %zu points of the walk, discover radius %d\n", n, discover);
+    std::printf ("   %5s %6s %11s %10s %13s %10s %12s\n", "res", "every", "segments",
+                 "cells/seg", "ns/segment", "discs", "ns/disc");
+    for (int res: { 128, 256, 512, 1024, 2048 })
+    {
+        glm::vec2 const step (1.f / float (res));
+        for (std::size_t every: { 1, 10, 100 })
+        {
+            // The longest step of the walk is 300 game units, past it a segment is a jump
+            float const teleport = 300.f * float (every) * 1.5f;
+            std::vector<glm::ivec2> cells;
+            std::vector<std::pair<glm::ivec2, glm::ivec2>> segments;
+            fog_grid fog;
+            fog.reset (res, discover, 255, 128, 0, teleport, 0);
+            for (std::size_t i = 0; i < n; i += every)
+            {
+                glm::ivec2 const cell (maptrack.game_to_map (path[i]) / step);
+                if (fog.claim (cell))
+                    cells.push_back (cell);
+                if (i >= every && glm::distance2 (path[i - every], path[i]) < teleport * teleport)
+                    if (glm::ivec2 const from (maptrack.game_to_map (path[i - every]) / step);
+                            from != cell)
+                        segments.push_back ({ from, cell });
+            }
+
+            auto a = bench::clock::now ();
+            for (auto const& c: cells)
+                fog.disc (c, 0, res);
+            double const discs = bench::since (a);
+            a = bench::clock::now ();
+            for (auto const& [from, to]: segments)
+                fog.segment (from, to, 0, res);
+            double const segs = bench::since (a);
+
+            double length = 0;
+            for (auto const& [from, to]: segments)
+                length += glm::length (glm::vec2 (to - from));
+            auto const ns = std::max<std::size_t> (segments.size (), 1);
+            std::printf ("   %5d %6zu %11zu %10.2f %10.1f ns %10zu %9.1f ns\n", res, every,
+                         segments.size (), length / double (ns), segs / double (ns) * 1e9,
+                         cells.size (), discs / double (std::max<std::size_t> (cells.size (), 1))
+                         * 1e9);
+        }
+    }
+    return missing || extra;
+}
+
+//--------------------------------------------------------------------------------------------------
+
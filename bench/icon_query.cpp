@@ -0,0 +1,234 @@
+/**
+ * @file icon_query.cpp
+ * @brief The icon grid against a scan of all the icons, for the view and the right click
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: icon_query [icons]
+ *
+ * The icons, 100k by default, are a quarter to four times the default size, half of them around
+ * a few hundred places and some past the edges of the map. One in 500 is 16 times larger, as
+ * a label over a whole region. Their ids stay the slots they were
+ * made in, as the icon list keeps them: a tenth of them are moved and another tenth removed,
+ * which leaves the ids with holes. Then the grid is queried as draw_icons() does, the viewport
+ * with its ids put in order and the point of a right click for the lowest id over it, each
+ * against a scan of all the icons in id order, as the plugin did before the grid. The results
+ * of both must be the same.
+ */
+
+#include "icon_grid.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock clock;
+
+double
+since (clock::time_point a)
+{
+    return std::chrono::duration<double> (clock::now () - a).count ();
+}
+
+struct icon
+{
+    glm::vec2 tl, br;
+    bool alive = true;
+};
+
+/// Of the map UV square, as made by the default icon size of 64 pixels over a 4096 texture
+struct icon_maker
+{
+    std::mt19937 rng { 18 };
+    std::uniform_real_distribution<float> u { 0, 1 }, scale { .25f, 4.f };
+    std::normal_distribution<float> near { 0, .01f };
+    std::vector<glm::vec2> places;
+
+    icon_maker () : places (300)
+    {
+        for (auto& p: places)
+            p = { u (rng), u (rng) };
+    }
+
+    icon operator () ()
+    {
+        glm::vec2 c (u (rng) * 1.04f - .02f, u (rng) * 1.04f - .02f);
+        if (u (rng) < .5f)
+            c = places[rng () % places.size ()] + glm::vec2 (near (rng), near (rng));
+        float const half = scale (rng) * .5f * 64 / 4096 * (u (rng) < .002f ? 16 : 1);
+        return icon { c - half, c + half };
+    }
+};
+
+bool
+overlaps (icon const& i, glm::vec2 const& tl, glm::vec2 const& br)
+{
+    return i.tl.x < br.x && i.br.x > tl.x && i.tl.y < br.y && i.br.y > tl.y;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::size_t const n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 100'000;
+
+    bench::icon_maker make;
+    std::vector<bench::icon> icons (n);
+    for (auto& i: icons)
+        i = make ();
+
+    icon_grid grid;
+    auto a = bench::clock::now ();
+    for (std::uint32_t k = 0; k < n; ++k)
+        grid.insert (k, icons[k].tl, icons[k].br);
+    double const build = bench::since (a);
+
+    // The edits keep the ids of the others
+    std::size_t const edits = n / 10;
+    std::vector<std::uint32_t> order (n);
+    for (std::uint32_t k = 0; k < n; ++k)
+        order[k] = k;
+    std::shuffle (order.begin (), order.end (), make.rng);
+    a = bench::clock::now ();
+    for (std::size_t e = 0; e < edits; ++e)
+    {
+        auto& i = icons[order[e]];
+        auto const old = i;
+        i = make ();
+        grid.move (order[e], old.tl, old.br, i.tl, i.br);
+    }
+    double const moves = bench::since (a);
+    a = bench::clock::now ();
+    for (std::size_t e = edits; e < 2 * edits; ++e)
+    {
+        auto& i = icons[order[e]];
+        grid.remove (order[e], i.tl, i.br);
+        i.alive = false;
+    }
+    double const removes = bench::since (a);
+    std::printf ("== %zu icons: built in %.1f ms, %zu moved at %.2f us, %zu removed at %.2f us\n",
+                 n, build * 1e3, edits, moves / double (edits) * 1e6, edits,
+                 removes / double (edits) * 1e6);
+
+    int wrong = 0;
+    std::printf ("   %-14s %8s %12s %12s\n", "view", "icons", "scan", "grid");
+    for (float zoom: { 1.f, .2f, .05f })
+    {
+        std::vector<std::uint32_t> scanned, found;
+        std::vector<bool> marked;
+        double scan = 0, query = 0;
+        std::size_t shown = 0;
+        int const views = 20;
+        for (int v = 0; v < views; ++v)
+        {
+            glm::vec2 const tl = glm::vec2 (make.u (make.rng), make.u (make.rng)) * (1 - zoom);
+            glm::vec2 const br = tl + zoom;
+
+            a = bench::clock::now ();
+            scanned.clear ();
+            for (std::uint32_t k = 0; k < n; ++k)
+                if (icons[k].alive && bench::overlaps (icons[k], tl, br))
+                    scanned.push_back (k);
+            scan += bench::since (a);
+
+            // As draw_icons() puts them in order
+            a = bench::clock::now ();
+            found.clear ();
+            bool const sorted = grid.query (tl, br, [&] (std::uint32_t k) { found.push_back (k); });
+            if (!sorted && found.size () * 16 < n)
+                std::sort (found.begin (), found.end ());
+            else if (!sorted)
+            {
+                marked.assign (n, false);
+                for (auto k: found)
+                    marked[k] = true;
+                found.clear ();
+                for (std::uint32_t k = 0; k < n; ++k)
+                    if (marked[k])
+                        found.push_back (k);
+            }
+            query += bench::since (a);
+
+            wrong += found != scanned;
+            shown += found.size ();
+        }
+        std::printf ("   %5.0f%% of map %8zu %9.1f us %9.1f us\n", zoom * 100,
+                     shown / views, scan / views * 1e6, query / views * 1e6);
+    }
+
+    // The right click, as the former find_if which stops at the first icon over the point
+    int const clicks = 10'000;
+    double scan = 0, query = 0;
+    int hits = 0;
+    for (int c = 0; c < clicks; ++c)
+    {
+        glm::vec2 const p (make.u (make.rng), make.u (make.rng));
+        a = bench::clock::now ();
+        auto const it = std::find_if (icons.cbegin (), icons.cend (), [&p] (bench::icon const& i) {
+            return i.alive && i.tl.x <= p.x && i.tl.y <= p.y && i.br.x >= p.x && i.br.y >= p.y;
+        });
+        auto const first = std::uint32_t (it - icons.cbegin ());
+        scan += bench::since (a);
+
+        a = bench::clock::now ();
+        auto hit = grid.lowest (p);
+        query += bench::since (a);
+        if (hit == icon_grid::none)
+            hit = std::uint32_t (n);
+
+        wrong += hit != first;
+        hits += hit != n;
+    }
+    std::printf ("   %-14s %8d %9.2f us %9.2f us\n", "right click", hits, scan / clicks * 1e6,
+                 query / clicks * 1e6);
+
+    // The far zooms draw the clusters instead
+    std::printf ("   clusters:");
+    for (unsigned level = 0; level < icon_grid::levels; ++level)
+    {
+        std::size_t count = 0, icons_in = 0;
+        a = bench::clock::now ();
+        grid.query_clusters (level, glm::vec2 (0), glm::vec2 (1),
+                [&] (icon_grid::cluster const& c) { ++count, icons_in += c.count; });
+        double const t = bench::since (a);
+        wrong += icons_in != n - edits;
+        std::printf (" %zu in %.1f us%s", count, t * 1e6,
+                     level + 1 < icon_grid::levels ? "," : "\n");
+    }
+
+    if (wrong)
+        std::fprintf (stderr, "%d queries not the same as the scan\n", wrong);
+    return wrong != 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
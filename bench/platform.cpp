@@ -0,0 +1,363 @@
+/**
+ * @file platform.cpp
+ * @brief Implements the game, SKSE and Windows as mocked for the benchmarks
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The file names are used as they are: the plugin directory with its backslashes is only a prefix
+ * of the names of the files in the working directory.
+ */
+
+#include "platform.hpp"
+#include "recording_imgui.hpp"
+
+#include <sse-imgui/sse-imgui.h>
+#include <sse-hooks/sse-hooks.h>
+#include <utils/winutils.hpp>
+#include <utils/plugin.hpp>
+#include <d3d11.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <sys/stat.h>
+
+//--------------------------------------------------------------------------------------------------
+
+/// As share/utils/skse.cpp has them
+sseimgui_api sseimgui = {};
+imgui_api imgui = {};
+sseh_api sseh = {};
+
+namespace {
+
+/// The objects of the game reached by the relocations of src/variables.cpp, at their offsets
+struct named_form
+{
+    char const* fullname;
+};
+
+struct player_character
+{
+    float position[3];
+    named_form const* cell;
+    named_form const* worldspace;
+};
+
+struct calendar
+{
+    float days;
+};
+
+struct image
+{
+    calendar* game_time;
+    player_character* player;
+};
+
+game_state state;
+calendar mock_calendar;
+player_character mock_player;
+named_form mock_cell, mock_worldspace;
+image mock_image { &mock_calendar, &mock_player };
+
+TIMERPROC timer = nullptr;
+HWND timer_window = nullptr;
+UINT_PTR timer_id = 0;
+sseimgui_render_callback listener = nullptr;
+std::uint64_t messages = 0;
+DWORD last_error = 0;
+
+/// The textures of the DDS files and their views, alive as long as the plugin
+std::deque<ID3D11Texture2D> textures;
+std::deque<ID3D11ShaderResourceView> views;
+
+int SSEH_CCONV
+find_target (char const* name, std::uintptr_t* target)
+{
+    static std::pair<char const*, std::uintptr_t> const targets[] = {
+        { "GameTime",                   offsetof (image, game_time) },
+        { "GameTime.Offset",            offsetof (calendar, days) },
+        { "PlayerCharacter",            offsetof (image, player) },
+        { "PlayerCharacter.Position",   offsetof (player_character, position) },
+        { "PlayerCharacter.Cell",       offsetof (player_character, cell) },
+        { "PlayerCharacter.Worldspace", offsetof (player_character, worldspace) },
+        { "Worldspace.Fullname",        offsetof (named_form, fullname) },
+        { "Cell.Fullname",              offsetof (named_form, fullname) },
+    };
+    for (auto const& t: targets)
+        if (!std::strcmp (t.first, name))
+        {
+            *target = t.second;
+            return true;
+        }
+    return false;
+}
+
+void SSEIMGUI_CCONV
+version (int* api, int* maj, int* imp, char const** timestamp)
+{
+    if (api) *api = SSEIMGUI_API_VERSION;
+    if (maj) *maj = 1;
+    if (imp) *imp = 1;
+    if (timestamp) *timestamp = PLUGIN_TIMESTAMP;
+}
+
+void SSEIMGUI_CCONV
+render_listener (sseimgui_render_callback callback, int remove)
+{
+    listener = remove ? nullptr : callback;
+}
+
+/// Any file makes a texture of the size of the ones shipped, existing or not
+int SSEIMGUI_CCONV
+ddsfile_texture (char const*, void*, void* view)
+{
+    textures.push_back (ID3D11Texture2D { { 4096, 4096 } });
+    views.push_back (ID3D11ShaderResourceView { &textures.back () });
+    *static_cast<ID3D11ShaderResourceView**> (view) = &views.back ();
+    return true;
+}
+
+std::wstring
+widen (std::string const& s)
+{
+    std::wstring w;
+    utf8_to_utf16 (s.c_str (), w);
+    return w;
+}
+
+std::string
+narrow (wchar_t const* w)
+{
+    std::string s;
+    utf16_to_utf8 (w, s);
+    return s;
+}
+
+/// The wildcards are only of a single star, as the plugin makes them
+struct find_handle
+{
+    std::string prefix, suffix;
+    std::filesystem::directory_iterator it;
+};
+
+bool
+find_next (find_handle& h, WIN32_FIND_DATA* data)
+{
+    std::error_code ec;
+    for (; h.it != std::filesystem::directory_iterator (); h.it.increment (ec))
+    {
+        auto const name = h.it->path ().filename ().string ();
+        if (name.size () < h.prefix.size () + h.suffix.size ()
+                || name.compare (0, h.prefix.size (), h.prefix)
+                || name.compare (name.size () - h.suffix.size (), h.suffix.size (), h.suffix))
+            continue;
+        auto const w = widen (name);
+        auto const n = std::min (w.size (), std::size (data->cFileName) - 1);
+        std::wmemcpy (data->cFileName, w.c_str (), n);
+        data->cFileName[n] = 0;
+        data->dwFileAttributes = h.it->is_directory (ec) ? FILE_ATTRIBUTE_DIRECTORY
+                                                         : FILE_ATTRIBUTE_NORMAL;
+        h.it.increment (ec);
+        return true;
+    }
+    last_error = ERROR_NO_MORE_FILES;
+    return false;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+KNOWNFOLDERID const FOLDERID_Documents = {};
+
+int
+MultiByteToWideChar (UINT, DWORD, char const* bytes, int bytes_size, wchar_t* wide, int wide_size)
+{
+    if (wide)
+        for (int i = 0; i < std::min (bytes_size, wide_size); ++i)
+            wide[i] = wchar_t (static_cast<unsigned char> (bytes[i]));
+    return bytes_size;
+}
+
+int
+WideCharToMultiByte (UINT, DWORD, wchar_t const* wide, int wide_size, char* bytes, int bytes_size,
+                     char const*, int*)
+{
+    if (bytes)
+        for (int i = 0; i < std::min (wide_size, bytes_size); ++i)
+            bytes[i] = char (wide[i]);
+    return wide_size;
+}
+
+DWORD
+GetLastError ()
+{
+    return last_error;
+}
+
+HMODULE
+GetModuleHandle (wchar_t const*)
+{
+    return &mock_image;
+}
+
+DWORD
+GetFileAttributesW (wchar_t const* name)
+{
+    struct stat st;
+    if (::stat (narrow (name).c_str (), &st))
+    {
+        last_error = ERROR_FILE_NOT_FOUND;
+        return INVALID_FILE_ATTRIBUTES;
+    }
+    return S_ISDIR (st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+HANDLE
+FindFirstFile (wchar_t const* wildcard, WIN32_FIND_DATA* data)
+{
+    auto const pattern = narrow (wildcard);
+    auto const star = pattern.find ('*');
+    auto h = std::make_unique<find_handle> ();
+    h->prefix = pattern.substr (0, star);
+    h->suffix = star == std::string::npos ? std::string () : pattern.substr (star + 1);
+    std::error_code ec;
+    h->it = std::filesystem::directory_iterator (".", ec);
+    if (ec || !find_next (*h, data))
+    {
+        last_error = ERROR_FILE_NOT_FOUND;
+        return INVALID_HANDLE_VALUE;
+    }
+    return h.release ();
+}
+
+int
+FindNextFile (HANDLE h, WIN32_FIND_DATA* data)
+{
+    return find_next (*static_cast<find_handle*> (h), data);
+}
+
+int
+FindClose (HANDLE h)
+{
+    delete static_cast<find_handle*> (h);
+    return true;
+}
+
+UINT_PTR
+SetTimer (HWND hwnd, UINT_PTR id, UINT, TIMERPROC callback)
+{
+    timer_window = hwnd;
+    timer_id = id;
+    timer = callback;
+    return id;
+}
+
+HRESULT
+SHGetKnownFolderPath (REFKNOWNFOLDERID, DWORD, HANDLE, PWSTR* path)
+{
+    *path = nullptr;
+    return E_FAIL;
+}
+
+void
+CoTaskMemFree (void*)
+{
+}
+
+std::string
+format_utf8message (DWORD error_code)
+{
+    return "error " + std::to_string (error_code);
+}
+
+bool
+dispatch_skse_message (char const*, int, void const*, std::size_t)
+{
+    ++messages;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+game_state&
+game ()
+{
+    return state;
+}
+
+/// As share/utils/skse.cpp does on the messages of SKSE, SSE Hooks and SSE ImGui
+
+bool
+load_plugin ()
+{
+    open_log (plugin_name ());
+
+    sseh.find_target = find_target;
+    sseimgui.version = version;
+    sseimgui.render_listener = render_listener;
+    sseimgui.make_imgui_api = make_recording_imgui;
+    sseimgui.ddsfile_texture = ddsfile_texture;
+
+    imgui = sseimgui.make_imgui_api ();
+    extern bool setup ();
+    if (!setup ())
+        return false;
+    extern void render (int);
+    sseimgui.render_listener (&render, 0);
+    return listener;
+}
+
+bool
+game_tick ()
+{
+    mock_calendar.days = state.time;
+    std::copy_n (state.position, 3, mock_player.position);
+    mock_worldspace.fullname = state.worldspace;
+    mock_player.worldspace = state.worldspace ? &mock_worldspace : nullptr;
+    mock_cell.fullname = state.cell;
+    mock_player.cell = state.cell ? &mock_cell : nullptr;
+    if (!timer)
+        return false;
+    timer (timer_window, 0x113 /* WM_TIMER */, timer_id, 0);
+    return true;
+}
+
+void
+render_frame ()
+{
+    if (listener)
+        listener (1);
+}
+
+std::uint64_t
+dispatched_messages ()
+{
+    return messages;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+/**
+ * @file platform.hpp
+ * @brief The game, SKSE and Windows as seen by the plugin, mocked for the benchmarks
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Takes the place of share/utils/skse.cpp: the plugin is set up as on the SSE ImGui message,
+ * with the ImGui table of the recording backend. The variables of the game are read through the
+ * relocations of src/variables.cpp, over a mocked image of the game, and the timer set by the
+ * plugin is run on demand.
+ */
+
+#ifndef BENCH_PLATFORM_HPP
+#define BENCH_PLATFORM_HPP
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/// As the game would tell to the plugin
+struct game_state
+{
+    float time = .45f;                  ///< Days since the start, as the calendar of the game
+    float position[3] = {};             ///< Of the player
+    char const* worldspace = "Skyrim";  ///< None in the main menu
+    char const* cell = nullptr;         ///< None for the exterior cells
+};
+
+game_state& game ();
+
+/// Sets up the plugin as SKSE and SSE ImGui would, returns whether it accepted
+bool load_plugin ();
+
+/// Calls the timer the plugin set, as Windows would on its period. False without one.
+bool game_tick ();
+
+/// Calls the render listener of the plugin, as SSE ImGui would once per frame
+void render_frame ();
+
+/// Messages sent to the other plugins, as to SSE Journal
+std::uint64_t dispatched_messages ();
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
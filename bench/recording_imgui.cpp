@@ -0,0 +1,1868 @@
+/**
+ * @file recording_imgui.cpp
+ * @brief Implements the headless ImGui table of the benchmarks
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * The font is a fixed pitch one of half its size per character, as Inconsolata is, and its atlas
+ * has no pixels. Of the widgets, the sliders and drags follow the mouse, the buttons, check and
+ * radio boxes, combo and list boxes take clicks, while the text input and the color edits only
+ * draw.
+ */
+
+#include "recording_imgui.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// ImVector growth, as ImGui does it
+template<class V> void
+reserve (V& v, int n)
+{
+    if (n <= v.Capacity)
+        return;
+    int c = std::max (v.Capacity ? v.Capacity + v.Capacity / 2 : 8, n);
+    v.Data = static_cast<decltype (v.Data)> (std::realloc (v.Data, std::size_t (c) * sizeof *v.Data));
+    v.Capacity = c;
+}
+
+template<class V> void
+resize (V& v, int n)
+{
+    reserve (v, n);
+    v.Size = n;
+}
+
+template<class V, class T> void
+push_back (V& v, T const& x)
+{
+    reserve (v, v.Size + 1);
+    v.Data[v.Size++] = x;
+}
+
+template<class V> auto&
+back (V& v)
+{
+    return v.Data[v.Size - 1];
+}
+
+inline ImVec2 operator + (ImVec2 a, ImVec2 b) { return { a.x + b.x, a.y + b.y }; }
+inline ImVec2 operator - (ImVec2 a, ImVec2 b) { return { a.x - b.x, a.y - b.y }; }
+inline ImVec2 operator * (ImVec2 a, float s) { return { a.x * s, a.y * s }; }
+
+inline bool
+contains (ImVec4 const& r, ImVec2 const& p)
+{
+    return p.x >= r.x && p.y >= r.y && p.x < r.z && p.y < r.w;
+}
+
+[[noreturn]] void
+unsupported (char const* what)
+{
+    std::fprintf (stderr, "recording_imgui: %s is not emulated\n", what);
+    std::abort ();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+struct window
+{
+    std::string name;
+    ImVec2 pos, size;
+    bool placed = false;        ///< By the user or by the plugin, otherwise yet to be
+    bool popup = false, tooltip = false, title = true;
+    int frame = -1;             ///< Begun last in
+    ImDrawList* list = nullptr;
+
+    ImVec2 cursor, cursor_start, cursor_max, prev_line;
+    float line_height = 0, prev_line_height = 0;
+    float indent = 0;           ///< Of the line starts, from the window position
+
+    struct group
+    {
+        ImVec2 cursor, cursor_max;
+        float indent, line_height;
+    };
+    std::vector<group> groups;
+
+    ImVec4 rect () const { return { pos.x, pos.y, pos.x + size.x, pos.y + size.y }; }
+};
+
+struct popup
+{
+    unsigned id;
+    ImVec2 pos;
+};
+
+struct context
+{
+    ImGuiIO io;
+    ImGuiStyle style;
+    ImGuiViewport viewport;
+    ImFontAtlas atlas;
+    ImDrawListSharedData shared;
+    std::vector<std::unique_ptr<ImFont>> fonts;
+    std::vector<ImFont*> font_stack;
+
+    std::unordered_map<std::string, std::unique_ptr<window>> windows;
+    std::vector<window*> stack, order, last_order;
+    window* hovered_window = nullptr;
+    int frame = 0;
+
+    struct { ImVec2 size; int cond; bool set; } next_window_size;
+    float next_item_width = NAN;
+
+    ImVec4 item;                ///< Of the last item
+    unsigned item_id = 0;
+    bool item_hovered = false;
+    unsigned active_id = 0;     ///< Of the item held by the mouse
+    bool active_seen = false;
+
+    std::vector<std::pair<int, ImVec4>> colors;
+    std::vector<std::pair<int, ImVec2>> vars;
+    std::vector<float> wraps;
+    std::vector<popup> popups;  ///< Open, the parents first
+
+    std::unordered_map<std::string, ImVec4> items, last_items;
+    bool mouse_prev[2] = {};
+    ImVec2 mouse_prev_pos { -1, -1 };
+    recording_stats stats;
+};
+
+context g = {};
+
+/// The pixels of the font atlas are never looked at, its views are only told apart
+char font_texture;
+
+window& current () { return *g.stack.back (); }
+ImFont* current_font () { return g.font_stack.back (); }
+
+float
+font_size ()
+{
+    auto f = current_font ();
+    return f->FontSize * f->Scale * g.io.FontGlobalScale;
+}
+
+float frame_height () { return font_size () + 2 * g.style.FramePadding.y; }
+
+ImU32
+color_u32 (ImVec4 c)
+{
+    auto sat = [] (float v) { return ImU32 (std::clamp (v, 0.f, 1.f) * 255 + .5f); };
+    c.w *= g.style.Alpha;
+    return sat (c.x) << IM_COL32_R_SHIFT | sat (c.y) << IM_COL32_G_SHIFT
+         | sat (c.z) << IM_COL32_B_SHIFT | sat (c.w) << IM_COL32_A_SHIFT;
+}
+
+ImU32 style_color (int idx) { return color_u32 (g.style.Colors[idx]); }
+
+unsigned
+make_id (std::string_view label)
+{
+    auto const h = std::hash<std::string_view> {};
+    auto const& w = g.stack.empty () ? std::string () : current ().name;
+    return unsigned (h (w) * 31 + h (label)) | 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Draw lists, as in ImGui
+//--------------------------------------------------------------------------------------------------
+
+void
+add_draw_cmd (ImDrawList* dl)
+{
+    ImDrawCmd c = {};
+    c.ClipRect = dl->_CmdHeader.ClipRect;
+    c.TextureId = dl->_CmdHeader.TextureId;
+    c.VtxOffset = dl->_CmdHeader.VtxOffset;
+    c.IdxOffset = unsigned (dl->IdxBuffer.Size);
+    push_back (dl->CmdBuffer, c);
+}
+
+bool
+same_header (ImDrawCmdHeader const& h, ImDrawCmd const& c)
+{
+    return !std::memcmp (&h.ClipRect, &c.ClipRect, sizeof h.ClipRect)
+        && h.TextureId == c.TextureId && h.VtxOffset == c.VtxOffset;
+}
+
+void
+on_changed_clip_rect (ImDrawList* dl)
+{
+    auto curr = &back (dl->CmdBuffer);
+    if (curr->ElemCount
+            && std::memcmp (&curr->ClipRect, &dl->_CmdHeader.ClipRect, sizeof (ImVec4)))
+    {
+        add_draw_cmd (dl);
+        return;
+    }
+    if (!curr->ElemCount && dl->CmdBuffer.Size > 1
+            && same_header (dl->_CmdHeader, curr[-1]) && !curr[-1].UserCallback)
+    {
+        --dl->CmdBuffer.Size;
+        return;
+    }
+    curr->ClipRect = dl->_CmdHeader.ClipRect;
+}
+
+void
+on_changed_texture_id (ImDrawList* dl)
+{
+    auto curr = &back (dl->CmdBuffer);
+    if (curr->ElemCount && curr->TextureId != dl->_CmdHeader.TextureId)
+    {
+        add_draw_cmd (dl);
+        return;
+    }
+    if (!curr->ElemCount && dl->CmdBuffer.Size > 1
+            && same_header (dl->_CmdHeader, curr[-1]) && !curr[-1].UserCallback)
+    {
+        --dl->CmdBuffer.Size;
+        return;
+    }
+    curr->TextureId = dl->_CmdHeader.TextureId;
+}
+
+void
+on_changed_vtx_offset (ImDrawList* dl)
+{
+    dl->_VtxCurrentIdx = 0;
+    auto curr = &back (dl->CmdBuffer);
+    if (curr->ElemCount)
+    {
+        add_draw_cmd (dl);
+        return;
+    }
+    curr->VtxOffset = dl->_CmdHeader.VtxOffset;
+}
+
+ImDrawList*
+dl_make (ImDrawListSharedData const* shared)
+{
+    auto dl = static_cast<ImDrawList*> (std::calloc (1, sizeof (ImDrawList)));
+    dl->_Data = shared;
+    return dl;
+}
+
+void
+dl_reset_for_new_frame (ImDrawList* dl)
+{
+    dl->CmdBuffer.Size = dl->IdxBuffer.Size = dl->VtxBuffer.Size = 0;
+    dl->Flags = dl->_Data->InitialFlags;
+    std::memset (&dl->_CmdHeader, 0, sizeof dl->_CmdHeader);
+    dl->_VtxCurrentIdx = 0;
+    dl->_VtxWritePtr = nullptr;
+    dl->_IdxWritePtr = nullptr;
+    dl->_ClipRectStack.Size = dl->_TextureIdStack.Size = dl->_Path.Size = 0;
+    push_back (dl->CmdBuffer, ImDrawCmd {});
+    dl->_FringeScale = 1;
+}
+
+void
+dl_push_clip_rect (ImDrawList* dl, ImVec2 a, ImVec2 b, bool intersect)
+{
+    ImVec4 cr { a.x, a.y, b.x, b.y };
+    if (intersect)
+    {
+        auto const& c = dl->_CmdHeader.ClipRect;
+        cr.x = std::max (cr.x, c.x), cr.y = std::max (cr.y, c.y);
+        cr.z = std::min (cr.z, c.z), cr.w = std::min (cr.w, c.w);
+    }
+    cr.z = std::max (cr.x, cr.z), cr.w = std::max (cr.y, cr.w);
+    push_back (dl->_ClipRectStack, cr);
+    dl->_CmdHeader.ClipRect = cr;
+    on_changed_clip_rect (dl);
+}
+
+void
+dl_push_clip_rect_full_screen (ImDrawList* dl)
+{
+    auto const& r = dl->_Data->ClipRectFullscreen;
+    dl_push_clip_rect (dl, ImVec2 { r.x, r.y }, ImVec2 { r.z, r.w }, false);
+}
+
+void
+dl_pop_clip_rect (ImDrawList* dl)
+{
+    assert (dl->_ClipRectStack.Size > 0);
+    --dl->_ClipRectStack.Size;
+    dl->_CmdHeader.ClipRect = dl->_ClipRectStack.Size ? back (dl->_ClipRectStack)
+                                                      : dl->_Data->ClipRectFullscreen;
+    on_changed_clip_rect (dl);
+}
+
+void
+dl_push_texture_id (ImDrawList* dl, ImTextureID id)
+{
+    push_back (dl->_TextureIdStack, id);
+    dl->_CmdHeader.TextureId = id;
+    on_changed_texture_id (dl);
+}
+
+void
+dl_pop_texture_id (ImDrawList* dl)
+{
+    assert (dl->_TextureIdStack.Size > 0);
+    --dl->_TextureIdStack.Size;
+    dl->_CmdHeader.TextureId = dl->_TextureIdStack.Size ? back (dl->_TextureIdStack) : nullptr;
+    on_changed_texture_id (dl);
+}
+
+void
+dl_prim_reserve (ImDrawList* dl, int idx_count, int vtx_count)
+{
+    if (dl->_VtxCurrentIdx + unsigned (vtx_count) >= (1u << 16)
+            && (dl->Flags & ImDrawListFlags_AllowVtxOffset))
+    {
+        dl->_CmdHeader.VtxOffset = unsigned (dl->VtxBuffer.Size);
+        on_changed_vtx_offset (dl);
+    }
+    back (dl->CmdBuffer).ElemCount += unsigned (idx_count);
+    auto const v = dl->VtxBuffer.Size, i = dl->IdxBuffer.Size;
+    resize (dl->VtxBuffer, v + vtx_count);
+    resize (dl->IdxBuffer, i + idx_count);
+    dl->_VtxWritePtr = dl->VtxBuffer.Data + v;
+    dl->_IdxWritePtr = dl->IdxBuffer.Data + i;
+}
+
+void
+dl_prim_reserve_counted (ImDrawList* dl, int idx_count, int vtx_count)
+{
+    ++g.stats.reserves;
+    dl_prim_reserve (dl, idx_count, vtx_count);
+}
+
+/// A quad of two triangles, without any of its vertices out of @p v
+void
+prim_quad (ImDrawList* dl, ImVec2 const (&p)[4], ImVec2 const (&uv)[4], ImU32 col)
+{
+    auto const i = ImDrawIdx (dl->_VtxCurrentIdx);
+    auto w = dl->_IdxWritePtr;
+    w[0] = i, w[1] = ImDrawIdx (i + 1), w[2] = ImDrawIdx (i + 2);
+    w[3] = i, w[4] = ImDrawIdx (i + 2), w[5] = ImDrawIdx (i + 3);
+    for (int k = 0; k < 4; ++k)
+        dl->_VtxWritePtr[k] = ImDrawVert { p[k], uv[k], col };
+    dl->_VtxWritePtr += 4;
+    dl->_IdxWritePtr += 6;
+    dl->_VtxCurrentIdx += 4;
+}
+
+void
+add_rect_filled (ImDrawList* dl, ImVec2 a, ImVec2 c, ImU32 col)
+{
+    if (!(col & IM_COL32_A_MASK))
+        return;
+    auto const uv = dl->_Data->TexUvWhitePixel;
+    dl_prim_reserve (dl, 6, 4);
+    prim_quad (dl, { a, { c.x, a.y }, c, { a.x, c.y } }, { uv, uv, uv, uv }, col);
+}
+
+void
+dl_add_image (ImDrawList* dl, ImTextureID id, ImVec2 a, ImVec2 c, ImVec2 uva, ImVec2 uvc,
+              ImU32 col)
+{
+    if (!(col & IM_COL32_A_MASK))
+        return;
+    ++g.stats.images;
+    bool const push = id != dl->_CmdHeader.TextureId;
+    if (push)
+        dl_push_texture_id (dl, id);
+    dl_prim_reserve (dl, 6, 4);
+    prim_quad (dl, { a, { c.x, a.y }, c, { a.x, c.y } },
+                   { uva, { uvc.x, uva.y }, uvc, { uva.x, uvc.y } }, col);
+    if (push)
+        dl_pop_texture_id (dl);
+}
+
+/// The normals of the segments from each point, the last one closing the path
+std::vector<ImVec2>&
+normals (ImVec2 const* p, int n, bool closed)
+{
+    static std::vector<ImVec2> v;
+    v.resize (std::size_t (n));
+    int const count = closed ? n : n - 1;
+    for (int i = 0; i < count; ++i)
+    {
+        auto d = p[(i + 1) % n] - p[i];
+        float const l2 = d.x * d.x + d.y * d.y;
+        if (l2 > 0)
+            d = d * (1 / std::sqrt (l2));
+        v[std::size_t (i)] = ImVec2 { d.y, -d.x };
+    }
+    if (!closed)
+        v[std::size_t (n - 1)] = v[std::size_t (n - 2)];
+    return v;
+}
+
+/// Averaged normal of two segments, scaled to keep the width on the miter
+ImVec2
+miter (ImVec2 a, ImVec2 b)
+{
+    auto m = (a + b) * .5f;
+    float const d2 = m.x * m.x + m.y * m.y;
+    if (d2 > 1e-6f)
+        m = m * std::min (1 / d2, 100.f);
+    return m;
+}
+
+/// ImDrawList::AddPolyline, of its vertex and index counts in all of its cases
+void
+add_polyline (ImDrawList* dl, ImVec2 const* p, int n, ImU32 col, bool closed, float thickness)
+{
+    if (n < 2 || !(col & IM_COL32_A_MASK))
+        return;
+    int const count = closed ? n : n - 1;
+    auto const& nm = normals (p, n, closed);
+    auto const uv = dl->_Data->TexUvWhitePixel;
+    auto const trans = col & ~IM_COL32_A_MASK;
+    auto normal_at = [&] (int i) {
+        return closed || (i && i < n - 1) ? miter (nm[std::size_t ((i + n - 1) % n)], nm[std::size_t (i)])
+                                          : nm[std::size_t (i)];
+    };
+
+    if (!(dl->Flags & ImDrawListFlags_AntiAliasedLines))
+    {
+        dl_prim_reserve (dl, count * 6, count * 4);
+        for (int i = 0; i < count; ++i)
+        {
+            auto const a = p[i], b = p[(i + 1) % n];
+            auto const d = nm[std::size_t (i)] * (thickness * .5f);
+            prim_quad (dl, { a + d, b + d, b - d, a - d }, { uv, uv, uv, uv }, col);
+        }
+        return;
+    }
+
+    float const aa = dl->_FringeScale;
+    bool const thick = thickness > aa;
+    thickness = std::max (thickness, 1.f);
+    int const width = int (thickness);
+    bool const tex = (dl->Flags & ImDrawListFlags_AntiAliasedLinesUseTex)
+        && width == thickness && width < 63;
+    int const stride = tex ? 2 : thick ? 4 : 3;
+    int const per_segment = tex ? 6 : thick ? 18 : 12;
+    dl_prim_reserve (dl, count * per_segment, n * stride);
+
+    auto const base = dl->_VtxCurrentIdx;
+    auto v = dl->_VtxWritePtr;
+    float const half = thickness * .5f;
+    for (int i = 0; i < n; ++i)
+    {
+        auto const m = normal_at (i);
+        if (tex)
+        {
+            auto const& l = dl->_Data->TexUvLines[width];
+            *v++ = ImDrawVert { p[i] + m * (half + aa), { l.x, l.y }, col };
+            *v++ = ImDrawVert { p[i] - m * (half + aa), { l.z, l.w }, col };
+        }
+        else if (!thick)
+        {
+            *v++ = ImDrawVert { p[i], uv, col };
+            *v++ = ImDrawVert { p[i] + m * aa, uv, trans };
+            *v++ = ImDrawVert { p[i] - m * aa, uv, trans };
+        }
+        else
+        {
+            *v++ = ImDrawVert { p[i] + m * (half + aa), uv, trans };
+            *v++ = ImDrawVert { p[i] + m * half, uv, col };
+            *v++ = ImDrawVert { p[i] - m * half, uv, col };
+            *v++ = ImDrawVert { p[i] - m * (half + aa), uv, trans };
+        }
+    }
+
+    // Between the vertices across each of two points, two triangles for each two of them
+    auto w = dl->_IdxWritePtr;
+    for (int i = 0; i < count; ++i)
+    {
+        auto const a = base + unsigned (i * stride), b = base + unsigned ((i + 1) % n * stride);
+        for (int j = 0; j + 1 < stride; ++j, w += 6)
+        {
+            w[0] = ImDrawIdx (b + j), w[1] = ImDrawIdx (a + j), w[2] = ImDrawIdx (a + j + 1);
+            w[3] = ImDrawIdx (a + j + 1), w[4] = ImDrawIdx (b + j + 1), w[5] = ImDrawIdx (b + j);
+        }
+    }
+    dl->_VtxWritePtr = v;
+    dl->_IdxWritePtr = w;
+    dl->_VtxCurrentIdx += unsigned (n * stride);
+}
+
+void
+add_line (ImDrawList* dl, ImVec2 a, ImVec2 b, ImU32 col)
+{
+    ImVec2 const p[2] { a + ImVec2 { .5f, .5f }, b + ImVec2 { .5f, .5f } };
+    add_polyline (dl, p, 2, col, false, 1);
+}
+
+void
+add_rect (ImDrawList* dl, ImVec2 a, ImVec2 c, ImU32 col, float thickness)
+{
+    a = a + ImVec2 { .5f, .5f }, c = c - ImVec2 { .49f, .49f };
+    ImVec2 const p[4] { a, { c.x, a.y }, c, { a.x, c.y } };
+    add_polyline (dl, p, 4, col, true, thickness);
+}
+
+/// ImDrawList::AddConvexPolyFilled, with its anti-aliased fringe
+void
+add_convex_poly_filled (ImDrawList* dl, ImVec2 const* p, int n, ImU32 col)
+{
+    if (n < 3 || !(col & IM_COL32_A_MASK))
+        return;
+    auto const uv = dl->_Data->TexUvWhitePixel;
+    if (!(dl->Flags & ImDrawListFlags_AntiAliasedFill))
+    {
+        dl_prim_reserve (dl, (n - 2) * 3, n);
+        auto const base = dl->_VtxCurrentIdx;
+        for (int i = 0; i < n; ++i)
+            *dl->_VtxWritePtr++ = ImDrawVert { p[i], uv, col };
+        for (int i = 2; i < n; ++i, dl->_IdxWritePtr += 3)
+        {
+            dl->_IdxWritePtr[0] = ImDrawIdx (base);
+            dl->_IdxWritePtr[1] = ImDrawIdx (base + i - 1);
+            dl->_IdxWritePtr[2] = ImDrawIdx (base + i);
+        }
+        dl->_VtxCurrentIdx += unsigned (n);
+        return;
+    }
+
+    float const aa = dl->_FringeScale;
+    auto const trans = col & ~IM_COL32_A_MASK;
+    dl_prim_reserve (dl, (n - 2) * 3 + n * 6, n * 2);
+    auto const inner = dl->_VtxCurrentIdx, outer = inner + 1;
+    auto w = dl->_IdxWritePtr;
+    for (int i = 2; i < n; ++i, w += 3)
+    {
+        w[0] = ImDrawIdx (inner);
+        w[1] = ImDrawIdx (inner + (i - 1) * 2);
+        w[2] = ImDrawIdx (inner + i * 2);
+    }
+    auto const& nm = normals (p, n, true);
+    auto v = dl->_VtxWritePtr;
+    for (int i0 = n - 1, i1 = 0; i1 < n; i0 = i1++, w += 6)
+    {
+        auto const m = miter (nm[std::size_t (i0)], nm[std::size_t (i1)]) * (aa * .5f);
+        *v++ = ImDrawVert { p[i1] - m, uv, col };
+        *v++ = ImDrawVert { p[i1] + m, uv, trans };
+        w[0] = ImDrawIdx (inner + i1 * 2), w[1] = ImDrawIdx (inner + i0 * 2);
+        w[2] = ImDrawIdx (outer + i0 * 2), w[3] = ImDrawIdx (outer + i0 * 2);
+        w[4] = ImDrawIdx (outer + i1 * 2), w[5] = ImDrawIdx (inner + i1 * 2);
+    }
+    dl->_VtxWritePtr = v;
+    dl->_IdxWritePtr = w;
+    dl->_VtxCurrentIdx += unsigned (n * 2);
+}
+
+void
+add_circle_filled (ImDrawList* dl, ImVec2 c, float radius, ImU32 col, int segments)
+{
+    if (!(col & IM_COL32_A_MASK) || radius <= 0)
+        return;
+    segments = std::clamp (segments > 0 ? segments : 16, 3, 512);
+
+    // As the arc of ImGui, its last point short of the first one by a segment
+    static std::vector<ImVec2> path;
+    path.clear ();
+    float const a_max = 2 * float (M_PI) * float (segments - 1) / float (segments);
+    for (int i = 0; i < segments; ++i)
+    {
+        float const a = a_max * float (i) / float (segments - 1);
+        path.push_back (ImVec2 { c.x + std::cos (a) * radius, c.y + std::sin (a) * radius });
+    }
+    add_convex_poly_filled (dl, path.data (), int (path.size ()), col);
+}
+
+void
+dl_add_circle_filled (ImDrawList* dl, ImVec2 c, float radius, ImU32 col, int segments)
+{
+    ++g.stats.circles;
+    add_circle_filled (dl, c, radius, col, segments);
+}
+
+/// ImFont::RenderText without the wrapping, a glyph of every character but the blanks. The glyphs
+/// out of the clip rectangle on its sides are left out, the lines below it end the text.
+void
+dl_add_text_font (ImDrawList* dl, ImFont const* font, float size, ImVec2 pos, ImU32 col,
+                  char const* b, char const* e, float, ImVec4 const* fine_clip)
+{
+    if (!(col & IM_COL32_A_MASK))
+        return;
+    if (!e)
+        e = b + std::strlen (b);
+    if (b == e)
+        return;
+    if (!font)
+        font = dl->_Data->Font;
+    if (size == 0)
+        size = dl->_Data->FontSize;
+    assert (font->ContainerAtlas->TexID == dl->_CmdHeader.TextureId);
+
+    auto clip = dl->_CmdHeader.ClipRect;
+    if (fine_clip)
+    {
+        clip.x = std::max (clip.x, fine_clip->x), clip.y = std::max (clip.y, fine_clip->y);
+        clip.z = std::min (clip.z, fine_clip->z), clip.w = std::min (clip.w, fine_clip->w);
+    }
+    float const x0 = std::floor (pos.x), advance = size * .5f;
+    float x = x0, y = std::floor (pos.y);
+    if (y > clip.w)
+        return;
+
+    int const idx_max = int (e - b) * 6;
+    int const idx_expected = dl->IdxBuffer.Size + idx_max;
+    dl_prim_reserve (dl, idx_max, int (e - b) * 4);
+    for (auto s = b; s != e; ++s)
+    {
+        char const c = *s;
+        if (c == '\n')
+        {
+            x = x0, y += size;
+            if (y > clip.w)
+                break;
+            continue;
+        }
+        if (c == '\r')
+            continue;
+        float const gx0 = x + size * .05f, gx1 = x + size * .45f;
+        if (c != ' ' && c != '\t' && gx0 <= clip.z && gx1 >= clip.x)
+        {
+            ++g.stats.glyphs;
+            float const u = float (std::uint8_t (c) % 16) / 16, v = float (std::uint8_t (c) / 16) / 16;
+            ImVec2 const tl { gx0, y + size * .2f }, br { gx1, y + size * .9f };
+            prim_quad (dl, { tl, { br.x, tl.y }, br, { tl.x, br.y } },
+                       { { u, v }, { u + 1.f / 16, v }, { u + 1.f / 16, v + 1.f / 16 },
+                         { u, v + 1.f / 16 } }, col);
+        }
+        x += advance * (c == '\t' ? 4 : 1);
+    }
+
+    // Giving back what was reserved for the blanks and the clipped out
+    dl->VtxBuffer.Size = int (dl->_VtxWritePtr - dl->VtxBuffer.Data);
+    dl->IdxBuffer.Size = int (dl->_IdxWritePtr - dl->IdxBuffer.Data);
+    back (dl->CmdBuffer).ElemCount -= unsigned (idx_expected - dl->IdxBuffer.Size);
+}
+
+void
+dl_add_text (ImDrawList* dl, ImVec2 pos, ImU32 col, char const* b, char const* e)
+{
+    dl_add_text_font (dl, nullptr, 0, pos, col, b, e, 0, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Layout
+//--------------------------------------------------------------------------------------------------
+
+/// Where the visible part of a label ends, before any "##"
+char const*
+label_end (char const* text, char const* end = nullptr)
+{
+    if (!end)
+        end = text + std::strlen (text);
+    for (auto s = text; s + 1 < end; ++s)
+        if (s[0] == '#' && s[1] == '#')
+            return s;
+    return end;
+}
+
+ImVec2
+text_size (char const* text, char const* end, bool hide)
+{
+    if (!end)
+        end = text + std::strlen (text);
+    if (hide)
+        end = label_end (text, end);
+    float const size = font_size ();
+    int lines = 1, longest = 0, chars = 0;
+    for (auto s = text; s != end; ++s)
+        if (*s == '\n')
+            ++lines, chars = 0;
+        else longest = std::max (longest, ++chars);
+    return text == end ? ImVec2 { 0, size } : ImVec2 { float (longest) * size * .5f, float (lines) * size };
+}
+
+void
+render_text (ImVec2 pos, char const* text, char const* end, bool hide, ImU32 col)
+{
+    if (!end)
+        end = text + std::strlen (text);
+    if (hide)
+        end = label_end (text, end);
+    dl_add_text_font (current ().list, current_font (), font_size (), pos, col, text, end, 0,
+                      nullptr);
+}
+
+void
+render_frame (ImVec4 const& r, ImU32 col)
+{
+    auto dl = current ().list;
+    add_rect_filled (dl, { r.x, r.y }, { r.z, r.w }, col);
+    if (g.style.FrameBorderSize > 0)
+        add_rect (dl, { r.x, r.y }, { r.z, r.w }, style_color (ImGuiCol_Border),
+                  g.style.FrameBorderSize);
+}
+
+void
+item_size (ImVec2 size)
+{
+    auto& w = current ();
+    float const h = std::max (w.line_height, size.y);
+    w.prev_line = ImVec2 { w.cursor.x + size.x, w.cursor.y };
+    w.cursor = ImVec2 { w.pos.x + w.indent, w.cursor.y + h + g.style.ItemSpacing.y };
+    w.cursor_max.x = std::max (w.cursor_max.x, w.prev_line.x);
+    w.cursor_max.y = std::max (w.cursor_max.y, w.cursor.y - g.style.ItemSpacing.y);
+    w.prev_line_height = h;
+    w.line_height = 0;
+}
+
+/// Lays an item out at the cursor, the last one from then on
+ImVec4
+item_add (char const* label, ImVec2 size)
+{
+    auto& w = current ();
+    ImVec4 const r { w.cursor.x, w.cursor.y, w.cursor.x + size.x, w.cursor.y + size.y };
+    item_size (size);
+    g.item = r;
+    g.item_id = label ? make_id (label) : 0;
+    g.item_hovered = g.hovered_window == &w && contains (r, g.io.MousePos)
+                  && (!g.active_id || g.active_id == g.item_id);
+    if (label)
+        g.items[label] = r;
+    g.next_item_width = NAN;
+    return r;
+}
+
+/// Of the last item: pressed by a click released on it, held while the mouse is down from it
+bool
+item_behavior (bool* held = nullptr)
+{
+    if (g.item_hovered && g.io.MouseClicked[0])
+        g.active_id = g.item_id;
+    bool pressed = false;
+    bool const active = g.active_id == g.item_id;
+    if (active)
+    {
+        g.active_seen = true;
+        if (g.io.MouseReleased[0])
+            pressed = g.item_hovered, g.active_id = 0;
+    }
+    if (held)
+        *held = active && g.io.MouseDown[0];
+    return pressed;
+}
+
+float
+item_width ()
+{
+    auto& w = current ();
+    float v = std::isnan (g.next_item_width) ? std::floor (w.size.x * .65f) : g.next_item_width;
+    if (v < 0)
+        v = std::max (1.f, w.pos.x + w.size.x - g.style.WindowPadding.x - w.cursor.x + v);
+    return v;
+}
+
+/// The frame of a widget of the item width and its label on the right
+ImVec4
+framed_item (char const* label, float height, float& frame_w)
+{
+    frame_w = item_width ();
+    auto const l = text_size (label, nullptr, true);
+    float const w = frame_w + (l.x > 0 ? g.style.ItemInnerSpacing.x + l.x : 0);
+    auto const r = item_add (label, ImVec2 { w, std::max (height, l.y) });
+    render_text (ImVec2 { r.x + frame_w + g.style.ItemInnerSpacing.x,
+                          r.y + g.style.FramePadding.y }, label, nullptr, true,
+                 style_color (ImGuiCol_Text));
+    return r;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Windows and popups
+//--------------------------------------------------------------------------------------------------
+
+window&
+find_window (std::string const& name)
+{
+    auto& w = g.windows[name];
+    if (!w)
+    {
+        w = std::make_unique<window> ();
+        w->name = name;
+        float const o = 60 + 30 * float (g.windows.size () - 1);
+        w->pos = ImVec2 { o, o };
+        w->size = ImVec2 { 400, 300 };
+        w->list = dl_make (&g.shared);
+    }
+    return *w;
+}
+
+void
+begin_window (window& w, bool* p_open)
+{
+    if (w.frame != g.frame)
+    {
+        w.frame = g.frame;
+        g.order.push_back (&w);
+        dl_reset_for_new_frame (w.list);
+    }
+    g.stack.push_back (&w);
+    g.shared.Font = current_font ();
+    g.shared.FontSize = font_size ();
+
+    auto dl = w.list;
+    dl_push_texture_id (dl, g.atlas.TexID);
+    dl_push_clip_rect (dl, w.pos, w.pos + w.size, false);
+    add_rect_filled (dl, w.pos, w.pos + w.size,
+                     style_color (w.popup || w.tooltip ? ImGuiCol_PopupBg : ImGuiCol_WindowBg));
+    float title = 0;
+    if (w.title)
+    {
+        title = frame_height ();
+        add_rect_filled (dl, w.pos, ImVec2 { w.pos.x + w.size.x, w.pos.y + title },
+                         style_color (ImGuiCol_TitleBgActive));
+        render_text (w.pos + g.style.FramePadding, w.name.c_str (), nullptr, true,
+                     style_color (ImGuiCol_Text));
+    }
+    if (g.style.WindowBorderSize > 0)
+        add_rect (dl, w.pos, w.pos + w.size, style_color (ImGuiCol_Border),
+                  g.style.WindowBorderSize);
+
+    w.indent = g.style.WindowPadding.x;
+    w.cursor = w.cursor_start = w.cursor_max = w.prev_line
+        = w.pos + ImVec2 { g.style.WindowPadding.x, title + g.style.WindowPadding.y };
+    w.line_height = w.prev_line_height = 0;
+    w.groups.clear ();
+
+    // The close button on the title bar, a cross
+    if (w.title && p_open)
+    {
+        float const s = font_size ();
+        auto const c = w.cursor;
+        w.cursor = ImVec2 { w.pos.x + w.size.x - g.style.FramePadding.x - s,
+                            w.pos.y + g.style.FramePadding.y };
+        auto const r = item_add ("#CLOSE", ImVec2 { s, s });
+        if (item_behavior ())
+            *p_open = false;
+        float const e = s * .25f;
+        add_line (dl, ImVec2 { r.x + e, r.y + e }, ImVec2 { r.z - e, r.w - e },
+                  style_color (ImGuiCol_Text));
+        add_line (dl, ImVec2 { r.z - e, r.y + e }, ImVec2 { r.x + e, r.w - e },
+                  style_color (ImGuiCol_Text));
+        w.cursor = w.cursor_max = w.prev_line = c;
+    }
+}
+
+void
+end_window ()
+{
+    auto& w = current ();
+    assert (w.groups.empty ());
+    dl_pop_clip_rect (w.list);
+    dl_pop_texture_id (w.list);
+
+    // The popups and tooltips fit their content on the next frame, as ImGui makes them
+    if (w.popup || w.tooltip)
+        w.size = (w.cursor_max - w.pos) + g.style.WindowPadding;
+    g.stack.pop_back ();
+    if (!g.stack.empty ())
+    {
+        g.shared.Font = current_font ();
+        g.shared.FontSize = font_size ();
+    }
+}
+
+bool
+ig_begin (char const* name, bool* p_open, ImGuiWindowFlags)
+{
+    auto& w = find_window (name);
+    if (g.next_window_size.set)
+    {
+        if (!(g.next_window_size.cond & ImGuiCond_FirstUseEver) || !w.placed)
+            w.size = g.next_window_size.size;
+        g.next_window_size.set = false;
+    }
+    w.placed = true;
+    begin_window (w, p_open);
+    return true;
+}
+
+void ig_end () { end_window (); }
+
+void
+ig_set_next_window_size (ImVec2 size, ImGuiCond cond)
+{
+    g.next_window_size = { size, cond, true };
+}
+
+/// The popups open at the level of the current window, as for ImGui
+std::size_t
+popup_level ()
+{
+    return std::size_t (std::count_if (g.stack.cbegin (), g.stack.cend (),
+                                       [] (window const* w) { return w->popup; }));
+}
+
+void
+ig_open_popup (char const* str_id, ImGuiPopupFlags)
+{
+    auto const id = make_id (str_id);
+    auto const level = popup_level ();
+    if (level < g.popups.size () && g.popups[level].id == id)
+        return;
+    g.popups.resize (level);
+    g.popups.push_back (popup { id, g.io.MousePos });
+}
+
+bool
+begin_popup (unsigned id, ImVec2 const* pos = nullptr)
+{
+    auto const level = popup_level ();
+    if (level >= g.popups.size () || g.popups[level].id != id)
+        return false;
+    char name[32];
+    std::snprintf (name, sizeof name, "##Popup_%08x", id);
+    auto& w = find_window (name);
+    if (!w.placed)
+        w.size = ImVec2 { 200, 100 };
+    w.popup = w.placed = true;
+    w.title = false;
+    w.pos = pos ? *pos : g.popups[level].pos;
+    begin_window (w, nullptr);
+    return true;
+}
+
+bool ig_begin_popup (char const* str_id, ImGuiWindowFlags) { return begin_popup (make_id (str_id)); }
+void ig_end_popup () { end_window (); }
+
+void
+ig_close_current_popup ()
+{
+    auto const level = popup_level ();
+    if (level)
+        g.popups.resize (std::min (g.popups.size (), level - 1));
+}
+
+void
+ig_begin_tooltip ()
+{
+    auto& w = find_window ("##Tooltip");
+    w.tooltip = w.placed = true;
+    w.title = false;
+    w.pos = g.io.MousePos + ImVec2 { 16, 8 };
+    begin_window (w, nullptr);
+}
+
+void ig_end_tooltip () { end_window (); }
+
+//--------------------------------------------------------------------------------------------------
+// Widgets
+//--------------------------------------------------------------------------------------------------
+
+void
+ig_text_unformatted (char const* text, char const* end)
+{
+    auto const r = item_add (nullptr, text_size (text, end, false));
+    render_text (ImVec2 { r.x, r.y }, text, end, false, style_color (ImGuiCol_Text));
+}
+
+void
+text_v (int color, char const* fmt, va_list args)
+{
+    static std::vector<char> buffer (1024);
+    va_list copy;
+    va_copy (copy, args);
+    int const n = std::vsnprintf (buffer.data (), buffer.size (), fmt, args);
+    if (n >= int (buffer.size ()))
+    {
+        buffer.resize (std::size_t (n) + 1);
+        std::vsnprintf (buffer.data (), buffer.size (), fmt, copy);
+    }
+    va_end (copy);
+    auto const end = buffer.data () + std::max (n, 0);
+    auto const r = item_add (nullptr, text_size (buffer.data (), end, false));
+    render_text (ImVec2 { r.x, r.y }, buffer.data (), end, false, style_color (color));
+}
+
+void
+ig_text (char const* fmt, ...)
+{
+    va_list args;
+    va_start (args, fmt);
+    text_v (ImGuiCol_Text, fmt, args);
+    va_end (args);
+}
+
+void
+ig_text_disabled (char const* fmt, ...)
+{
+    va_list args;
+    va_start (args, fmt);
+    text_v (ImGuiCol_TextDisabled, fmt, args);
+    va_end (args);
+}
+
+bool
+ig_button (char const* label, ImVec2 size)
+{
+    auto const l = text_size (label, nullptr, true);
+    size.x = size.x ? size.x : l.x + 2 * g.style.FramePadding.x;
+    size.y = size.y ? size.y : l.y + 2 * g.style.FramePadding.y;
+    auto const r = item_add (label, size);
+    bool held;
+    bool const pressed = item_behavior (&held);
+    render_frame (r, style_color (held && g.item_hovered ? ImGuiCol_ButtonActive
+                                : g.item_hovered ? ImGuiCol_ButtonHovered : ImGuiCol_Button));
+    render_text (ImVec2 { (r.x + r.z - l.x) * .5f, (r.y + r.w - l.y) * .5f }, label, nullptr, true,
+                 style_color (ImGuiCol_Text));
+    return pressed;
+}
+
+bool
+ig_invisible_button (char const* id, ImVec2 size, ImGuiButtonFlags)
+{
+    item_add (id, ImVec2 { std::max (size.x, 1.f), std::max (size.y, 1.f) });
+    return item_behavior ();
+}
+
+bool
+ig_checkbox (char const* label, bool* v)
+{
+    float const square = frame_height ();
+    auto const l = text_size (label, nullptr, true);
+    auto const r = item_add (label, ImVec2 {
+            square + (l.x > 0 ? g.style.ItemInnerSpacing.x + l.x : 0), square });
+    bool const pressed = item_behavior ();
+    if (pressed)
+        *v = !*v;
+    render_frame (ImVec4 { r.x, r.y, r.x + square, r.y + square }, style_color (ImGuiCol_FrameBg));
+    if (*v)
+    {
+        float const p = square / 6;
+        ImVec2 const mark[3] {
+            { r.x + p, r.y + square * .5f }, { r.x + square * .4f, r.y + square - 2 * p },
+            { r.x + square - p, r.y + p } };
+        add_polyline (current ().list, mark, 3, style_color (ImGuiCol_CheckMark), false,
+                      std::max (square / 5, 1.f));
+    }
+    render_text (ImVec2 { r.x + square + g.style.ItemInnerSpacing.x, r.y + g.style.FramePadding.y },
+                 label, nullptr, true, style_color (ImGuiCol_Text));
+    return pressed;
+}
+
+bool
+ig_radio_button (char const* label, bool active)
+{
+    float const square = frame_height ();
+    auto const l = text_size (label, nullptr, true);
+    auto const r = item_add (label, ImVec2 {
+            square + (l.x > 0 ? g.style.ItemInnerSpacing.x + l.x : 0), square });
+    bool const pressed = item_behavior ();
+    ImVec2 const c { r.x + square * .5f, r.y + square * .5f };
+    float const radius = (square - 1) * .5f;
+    add_circle_filled (current ().list, c, radius, style_color (ImGuiCol_FrameBg), 16);
+    if (active)
+        add_circle_filled (current ().list, c, radius / 2, style_color (ImGuiCol_CheckMark), 16);
+    render_text (ImVec2 { r.x + square + g.style.ItemInnerSpacing.x, r.y + g.style.FramePadding.y },
+                 label, nullptr, true, style_color (ImGuiCol_Text));
+    return pressed;
+}
+
+/// The frame of a slider or drag, with its value printed in the middle
+template<class T> void
+render_scalar (ImVec4 const& r, float frame_w, char const* format, T v, float grab)
+{
+    ImVec4 const f { r.x, r.y, r.x + frame_w, r.y + frame_height () };
+    render_frame (f, style_color (g.item_hovered ? ImGuiCol_FrameBgHovered : ImGuiCol_FrameBg));
+    if (grab >= 0)
+    {
+        float const gw = g.style.GrabMinSize;
+        float const x = f.x + 2 + grab * (frame_w - gw - 4);
+        add_rect_filled (current ().list, ImVec2 { x, f.y + 2 }, ImVec2 { x + gw, f.w - 2 },
+                         style_color (ImGuiCol_SliderGrab));
+    }
+    char value[64];
+    if constexpr (std::is_integral_v<T>)
+        std::snprintf (value, sizeof value, format ? format : "%d", v);
+    else std::snprintf (value, sizeof value, format ? format : "%.3f", double (v));
+    auto const s = text_size (value, nullptr, false);
+    render_text (ImVec2 { f.x + (frame_w - s.x) * .5f, f.y + g.style.FramePadding.y }, value,
+                 nullptr, false, style_color (ImGuiCol_Text));
+}
+
+template<class T> bool
+slider (char const* label, T* v, T lo, T hi, char const* format)
+{
+    float frame_w;
+    auto const r = framed_item (label, frame_height (), frame_w);
+    bool held;
+    item_behavior (&held);
+    bool changed = false;
+    if (held && hi > lo)
+    {
+        float const gw = g.style.GrabMinSize;
+        float const t = std::clamp ((g.io.MousePos.x - r.x - 2 - gw * .5f)
+                                    / std::max (frame_w - gw - 4, 1.f), 0.f, 1.f);
+        T const n = std::is_integral_v<T> ? T (std::lround (float (lo) + t * float (hi - lo)))
+                                          : T (float (lo) + t * float (hi - lo));
+        changed = n != *v;
+        *v = n;
+    }
+    float const t = hi > lo ? float (*v - lo) / float (hi - lo) : 0.f;
+    render_scalar (r, frame_w, format, *v, std::clamp (t, 0.f, 1.f));
+    return changed;
+}
+
+template<class T> bool
+drag (char const* label, T* v, float speed, T lo, T hi, char const* format)
+{
+    float frame_w;
+    auto const r = framed_item (label, frame_height (), frame_w);
+    bool held;
+    item_behavior (&held);
+    bool changed = false;
+    if (held && g.io.MouseDelta.x)
+    {
+        auto n = T (*v + (std::is_integral_v<T> ? T (std::lround (g.io.MouseDelta.x * speed))
+                                                : T (g.io.MouseDelta.x * speed)));
+        if (lo < hi)
+            n = std::clamp (n, lo, hi);
+        changed = n != *v;
+        *v = n;
+    }
+    render_scalar (r, frame_w, format, *v, -1);
+    return changed;
+}
+
+bool
+ig_slider_float (char const* label, float* v, float lo, float hi, char const* format,
+                 ImGuiSliderFlags)
+{
+    return slider (label, v, lo, hi, format);
+}
+
+bool
+ig_slider_int (char const* label, int* v, int lo, int hi, char const* format, ImGuiSliderFlags)
+{
+    return slider (label, v, lo, hi, format);
+}
+
+bool
+ig_drag_float (char const* label, float* v, float speed, float lo, float hi, char const* format,
+               ImGuiSliderFlags)
+{
+    return drag (label, v, speed, lo, hi, format);
+}
+
+bool
+ig_drag_int (char const* label, int* v, float speed, int lo, int hi, char const* format,
+             ImGuiSliderFlags)
+{
+    return drag (label, v, speed, lo, hi, format);
+}
+
+/// Four fields of the components and a button of the color, all only drawn
+bool
+ig_color_edit4 (char const* label, float col[4], ImGuiColorEditFlags)
+{
+    float frame_w;
+    float const square = frame_height ();
+    auto const r = framed_item (label, square, frame_w);
+    float const inner = g.style.ItemInnerSpacing.x;
+    float const field = std::max (1.f, (frame_w - square - inner * 4) / 4);
+    for (int k = 0; k < 4; ++k)
+    {
+        float const x = r.x + float (k) * (field + inner);
+        char value[16];
+        std::snprintf (value, sizeof value, "%.3f", double (col[k]));
+        render_frame (ImVec4 { x, r.y, x + field, r.y + square }, style_color (ImGuiCol_FrameBg));
+        render_text (ImVec2 { x + g.style.FramePadding.x, r.y + g.style.FramePadding.y }, value,
+                     nullptr, false, style_color (ImGuiCol_Text));
+    }
+    float const x = r.x + 4 * (field + inner);
+    render_frame (ImVec4 { x, r.y, x + square, r.y + square },
+                  color_u32 (ImVec4 { col[0], col[1], col[2], col[3] }));
+    return false;
+}
+
+bool
+ig_input_text (char const* label, char* buf, std::size_t, ImGuiInputTextFlags,
+               ImGuiInputTextCallback, void*)
+{
+    float frame_w;
+    auto const r = framed_item (label, frame_height (), frame_w);
+    item_behavior ();
+    render_frame (ImVec4 { r.x, r.y, r.x + frame_w, r.y + frame_height () },
+                  style_color (ImGuiCol_FrameBg));
+    auto const dl = current ().list;
+    ImVec4 const clip { r.x, r.y, r.x + frame_w, r.y + frame_height () };
+    dl_add_text_font (dl, current_font (), font_size (), ImVec2 { r.x, r.y } + g.style.FramePadding,
+                      style_color (ImGuiCol_Text), buf, nullptr, 0, &clip);
+    return false;
+}
+
+typedef bool (*items_getter) (void*, int, char const**);
+
+/// Items of a combo or list box, the ones at @p top and below, which are clicked to select. Each
+/// is an item of its own, as for ImGui, though not the last one.
+bool
+selectables (char const* label, int* current_item, items_getter getter, void* data, int count,
+             ImVec4 const& frame, int top)
+{
+    bool changed = false;
+    float const line = font_size () + g.style.ItemSpacing.y;
+    auto const hovered = g.hovered_window == &current ();
+    std::string name;
+    for (int i = top; i < count; ++i)
+    {
+        float const y = frame.y + g.style.FramePadding.y + float (i - top) * line;
+        if (y + line > frame.w)
+            break;
+        char const* text = nullptr;
+        if (!getter (data, i, &text) || !text)
+            text = "*Unknown item*";
+        ImVec4 const r { frame.x, y, frame.z, y + line };
+        name.assign (label).append ("/").append (std::to_string (i));
+        g.items[name] = r;
+        bool const over = hovered && contains (r, g.io.MousePos);
+        if (over || i == *current_item)
+            add_rect_filled (current ().list, ImVec2 { r.x, r.y }, ImVec2 { r.z, r.w },
+                             style_color (over ? ImGuiCol_HeaderHovered : ImGuiCol_Header));
+        render_text (ImVec2 { r.x + g.style.FramePadding.x, y }, text, nullptr, false,
+                     style_color (ImGuiCol_Text));
+        if (over && g.io.MouseReleased[0])
+            changed = *current_item != i, *current_item = i;
+    }
+    return changed;
+}
+
+bool
+ig_combo (char const* label, int* current_item, items_getter getter, void* data, int count,
+          int popup_max_height)
+{
+    float frame_w;
+    float const h = frame_height ();
+    auto const r = framed_item (label, h, frame_w);
+    auto const id = g.item_id;
+    if (item_behavior ())
+        ig_open_popup (label, 0);
+    render_frame (ImVec4 { r.x, r.y, r.x + frame_w - h, r.y + h }, style_color (ImGuiCol_FrameBg));
+    render_frame (ImVec4 { r.x + frame_w - h, r.y, r.x + frame_w, r.y + h },
+                  style_color (ImGuiCol_Button));
+    char const* preview = nullptr;
+    if (*current_item >= 0 && *current_item < count && getter (data, *current_item, &preview)
+            && preview)
+        render_text (ImVec2 { r.x, r.y } + g.style.FramePadding, preview, nullptr, false,
+                     style_color (ImGuiCol_Text));
+
+    bool changed = false;
+    ImVec2 const below { r.x, r.y + h };
+    if (begin_popup (make_id (label), &below))
+    {
+        int const shown = std::min (count, popup_max_height > 0 ? popup_max_height : 8);
+        auto const& w = current ();
+        ImVec4 const list { w.pos.x, w.pos.y, w.pos.x + frame_w,
+                            w.pos.y + float (shown) * (font_size () + g.style.ItemSpacing.y)
+                                    + 2 * g.style.FramePadding.y };
+        changed = selectables (label, current_item, getter, data, count, list, 0);
+        item_size (ImVec2 { list.z - list.x, list.w - list.y });
+        if (changed)
+            ig_close_current_popup ();
+        end_window ();
+    }
+    g.item_id = id;
+    return changed;
+}
+
+bool
+ig_list_box (char const* label, int* current_item, items_getter getter, void* data, int count,
+             int height_in_items)
+{
+    if (height_in_items < 0)
+        height_in_items = std::min (count, 7);
+    float const line = font_size () + g.style.ItemSpacing.y;
+    float frame_w;
+    auto const r = framed_item (label,
+            line * (float (height_in_items) + .25f) + 2 * g.style.FramePadding.y, frame_w);
+    ImVec4 const frame { r.x, r.y, r.x + frame_w, r.w };
+    render_frame (frame, style_color (ImGuiCol_FrameBg));
+    int const top = std::clamp (*current_item - height_in_items + 1, 0, std::max (count - 1, 0));
+    return selectables (label, current_item, getter, data, count, frame, top);
+}
+
+/// As ImGui::PlotEx of lines, the values sampled down to a segment per pixel, all of them read
+/// once when either of the scale bounds is left to them
+void
+ig_plot_lines (char const* label, float (*getter) (void*, int), void* data, int count,
+               int offset, char const* overlay, float scale_min, float scale_max, ImVec2 size)
+{
+    auto const l = text_size (label, nullptr, true);
+    if (size.x == 0)
+        size.x = item_width ();
+    if (size.y == 0)
+        size.y = l.y + 2 * g.style.FramePadding.y;
+    auto const r = item_add (label, ImVec2 {
+            size.x + (l.x > 0 ? g.style.ItemInnerSpacing.x + l.x : 0), size.y });
+    ImVec4 const frame { r.x, r.y, r.x + size.x, r.y + size.y };
+    render_frame (frame, style_color (ImGuiCol_FrameBg));
+    render_text (ImVec2 { frame.z + g.style.ItemInnerSpacing.x, frame.y + g.style.FramePadding.y },
+                 label, nullptr, true, style_color (ImGuiCol_Text));
+
+    if (scale_min == FLT_MAX || scale_max == FLT_MAX)
+    {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (int i = 0; i < count; ++i)
+        {
+            float const v = getter (data, i);
+            if (v == v)
+                lo = std::min (lo, v), hi = std::max (hi, v);
+        }
+        if (scale_min == FLT_MAX)
+            scale_min = lo;
+        if (scale_max == FLT_MAX)
+            scale_max = hi;
+    }
+    if (count < 2)
+        return;
+
+    ImVec4 const inner { frame.x + g.style.FramePadding.x, frame.y + g.style.FramePadding.y,
+                         frame.z - g.style.FramePadding.x, frame.w - g.style.FramePadding.y };
+    int const res_w = std::min (int (size.x), count) - 1, items = count - 1;
+    if (res_w < 1)
+        return;
+    float const t_step = 1.f / float (res_w);
+    float const inv_scale = scale_min == scale_max ? 0 : 1 / (scale_max - scale_min);
+    auto point = [&] (float t, float v) {
+        float const y = std::clamp ((v - scale_min) * inv_scale, 0.f, 1.f);
+        return ImVec2 { inner.x + (inner.z - inner.x) * t, inner.y + (inner.w - inner.y) * (1 - y) };
+    };
+    auto const col = style_color (ImGuiCol_PlotLines);
+    float t0 = 0;
+    auto p0 = point (0, getter (data, offset % count));
+    for (int n = 0; n < res_w; ++n)
+    {
+        float const t1 = t0 + t_step;
+        int const i1 = int (t0 * float (items) + .5f);
+        auto const p1 = point (t1, getter (data, (i1 + offset + 1) % count));
+        add_line (current ().list, p0, p1, col);
+        t0 = t1, p0 = p1;
+    }
+
+    if (overlay)
+        render_text (ImVec2 { inner.x, frame.y + g.style.FramePadding.y }, overlay, nullptr, false,
+                     style_color (ImGuiCol_Text));
+
+    // The value under the mouse
+    if (g.item_hovered && contains (inner, g.io.MousePos))
+    {
+        float const t = std::clamp ((g.io.MousePos.x - inner.x) / (inner.z - inner.x), 0.f, .9999f);
+        int const i = int (t * float (items));
+        float const v0 = getter (data, (i + offset) % count);
+        float const v1 = getter (data, (i + 1 + offset) % count);
+        auto const item = g.item;
+        auto const hovered = g.item_hovered;
+        ig_begin_tooltip ();
+        ig_text ("%d: %8.4g\n%d: %8.4g", i, double (v0), i + 1, double (v1));
+        ig_end_tooltip ();
+        g.item = item, g.item_hovered = hovered;
+    }
+}
+
+void
+ig_separator ()
+{
+    auto& w = current ();
+    float const x0 = w.cursor.x, x1 = w.pos.x + w.size.x - g.style.WindowPadding.x;
+    float const y = w.cursor.y;
+    item_add (nullptr, ImVec2 { 0, 1 });
+    add_line (w.list, ImVec2 { x0, y }, ImVec2 { x1, y }, style_color (ImGuiCol_Separator));
+}
+
+void ig_dummy (ImVec2 size) { item_add (nullptr, size); }
+
+void
+ig_same_line (float offset, float spacing)
+{
+    auto& w = current ();
+    if (offset != 0)
+        w.cursor.x = w.pos.x + offset + std::max (spacing, 0.f);
+    else w.cursor.x = w.prev_line.x + (spacing < 0 ? g.style.ItemSpacing.x : spacing);
+    w.cursor.y = w.prev_line.y;
+    w.line_height = w.prev_line_height;
+}
+
+void
+ig_begin_group ()
+{
+    auto& w = current ();
+    w.groups.push_back (window::group { w.cursor, w.cursor_max, w.indent, w.line_height });
+    w.indent = w.cursor.x - w.pos.x;
+    w.cursor_max = w.cursor;
+    w.line_height = 0;
+}
+
+void
+ig_end_group ()
+{
+    auto& w = current ();
+    auto const gd = w.groups.back ();
+    w.groups.pop_back ();
+    auto const max = ImVec2 { std::max (w.cursor_max.x, gd.cursor.x),
+                              std::max (w.cursor_max.y, gd.cursor.y) };
+    w.cursor = gd.cursor;
+    w.indent = gd.indent;
+    w.line_height = gd.line_height;
+    w.cursor_max = ImVec2 { std::max (gd.cursor_max.x, max.x), std::max (gd.cursor_max.y, max.y) };
+    item_size (max - gd.cursor);
+
+    // As the last item, hovered as a whole
+    g.item = ImVec4 { gd.cursor.x, gd.cursor.y, max.x, max.y };
+    g.item_id = 0;
+    g.item_hovered = g.hovered_window == &w && contains (g.item, g.io.MousePos);
+}
+
+bool ig_is_item_hovered (ImGuiHoveredFlags) { return g.item_hovered; }
+void ig_set_next_item_width (float w) { g.next_item_width = w; }
+
+//--------------------------------------------------------------------------------------------------
+// State
+//--------------------------------------------------------------------------------------------------
+
+ImGuiIO* ig_get_io () { return &g.io; }
+ImGuiStyle* ig_get_style () { return &g.style; }
+ImGuiViewport* ig_get_main_viewport () { return &g.viewport; }
+ImDrawListSharedData* ig_get_draw_list_shared_data () { return &g.shared; }
+ImDrawList* ig_get_window_draw_list () { return current ().list; }
+float ig_get_font_size () { return font_size (); }
+float ig_get_window_height () { return current ().size.y; }
+float ig_get_text_line_height_with_spacing () { return font_size () + g.style.ItemSpacing.y; }
+
+void ig_get_font_tex_uv_white_pixel (ImVec2* out) { *out = g.shared.TexUvWhitePixel; }
+void ig_get_window_pos (ImVec2* out) { *out = current ().pos; }
+void ig_get_cursor_pos (ImVec2* out) { *out = current ().cursor - current ().pos; }
+
+void
+ig_get_content_region_avail (ImVec2* out)
+{
+    auto const& w = current ();
+    *out = w.pos + w.size - g.style.WindowPadding - w.cursor;
+}
+
+void
+ig_calc_text_size (ImVec2* out, char const* text, char const* end, bool hide, float)
+{
+    *out = text_size (text, end, hide);
+}
+
+ImU32 ig_get_color_u32 (ImVec4 col) { return color_u32 (col); }
+
+void
+ig_color_convert_u32_to_float4 (ImVec4* out, ImU32 in)
+{
+    float const s = 1.f / 255;
+    *out = ImVec4 { float (in >> IM_COL32_R_SHIFT & 0xFF) * s, float (in >> IM_COL32_G_SHIFT & 0xFF) * s,
+                    float (in >> IM_COL32_B_SHIFT & 0xFF) * s, float (in >> IM_COL32_A_SHIFT & 0xFF) * s };
+}
+
+void
+ig_push_style_color (ImGuiCol idx, ImVec4 col)
+{
+    g.colors.emplace_back (idx, g.style.Colors[idx]);
+    g.style.Colors[idx] = col;
+}
+
+void
+ig_pop_style_color (int count)
+{
+    for (; count > 0; --count)
+    {
+        g.style.Colors[g.colors.back ().first] = g.colors.back ().second;
+        g.colors.pop_back ();
+    }
+}
+
+/// The style variables which are pushed, by their size in floats
+std::pair<float*, int>
+style_var (ImGuiStyleVar idx)
+{
+    auto& s = g.style;
+    switch (idx)
+    {
+        case ImGuiStyleVar_Alpha:               return { &s.Alpha, 1 };
+        case ImGuiStyleVar_WindowPadding:       return { &s.WindowPadding.x, 2 };
+        case ImGuiStyleVar_WindowRounding:      return { &s.WindowRounding, 1 };
+        case ImGuiStyleVar_WindowBorderSize:    return { &s.WindowBorderSize, 1 };
+        case ImGuiStyleVar_WindowMinSize:       return { &s.WindowMinSize.x, 2 };
+        case ImGuiStyleVar_FramePadding:        return { &s.FramePadding.x, 2 };
+        case ImGuiStyleVar_FrameRounding:       return { &s.FrameRounding, 1 };
+        case ImGuiStyleVar_FrameBorderSize:     return { &s.FrameBorderSize, 1 };
+        case ImGuiStyleVar_ItemSpacing:         return { &s.ItemSpacing.x, 2 };
+        case ImGuiStyleVar_ItemInnerSpacing:    return { &s.ItemInnerSpacing.x, 2 };
+        case ImGuiStyleVar_IndentSpacing:       return { &s.IndentSpacing, 1 };
+        case ImGuiStyleVar_GrabMinSize:         return { &s.GrabMinSize, 1 };
+        default: unsupported ("This style variable");
+    }
+}
+
+void
+push_style_var (ImGuiStyleVar idx, ImVec2 val, int n)
+{
+    auto [p, size] = style_var (idx);
+    if (size != n)
+        unsupported ("A style variable of another size");
+    g.vars.emplace_back (idx, ImVec2 { p[0], n > 1 ? p[1] : 0 });
+    p[0] = val.x;
+    if (n > 1)
+        p[1] = val.y;
+}
+
+void ig_push_style_var_float (ImGuiStyleVar idx, float val) { push_style_var (idx, { val, 0 }, 1); }
+void ig_push_style_var_vec2 (ImGuiStyleVar idx, ImVec2 val) { push_style_var (idx, val, 2); }
+
+void
+ig_pop_style_var (int count)
+{
+    for (; count > 0; --count)
+    {
+        auto [p, size] = style_var (g.vars.back ().first);
+        p[0] = g.vars.back ().second.x;
+        if (size > 1)
+            p[1] = g.vars.back ().second.y;
+        g.vars.pop_back ();
+    }
+}
+
+void
+ig_push_font (ImFont* font)
+{
+    g.font_stack.push_back (font ? font : g.font_stack.front ());
+    g.shared.Font = current_font ();
+    g.shared.FontSize = font_size ();
+}
+
+void
+ig_pop_font ()
+{
+    assert (g.font_stack.size () > 1);
+    g.font_stack.pop_back ();
+    g.shared.Font = current_font ();
+    g.shared.FontSize = font_size ();
+}
+
+void ig_push_text_wrap_pos (float x) { g.wraps.push_back (x); }
+void ig_pop_text_wrap_pos () { g.wraps.pop_back (); }
+
+ImFont*
+add_font (ImFontAtlas* atlas, float size)
+{
+    auto f = std::make_unique<ImFont> ();
+    f->FontSize = size;
+    f->Scale = 1;
+    f->FallbackAdvanceX = size * .5f;
+    f->ContainerAtlas = atlas;
+    f->Ascent = size * .8f, f->Descent = -size * .2f;
+    g.fonts.push_back (std::move (f));
+    push_back (atlas->Fonts, g.fonts.back ().get ());
+    if (g.font_stack.empty ())
+        g.font_stack.push_back (g.fonts.back ().get ());
+    return g.fonts.back ().get ();
+}
+
+ImFont*
+ig_add_font_from_file (ImFontAtlas* atlas, char const*, float size, ImFontConfig const*,
+                       ImWchar const*)
+{
+    return add_font (atlas, size);
+}
+
+ImFont*
+ig_add_font_from_base85 (ImFontAtlas* atlas, char const*, float size, ImFontConfig const*,
+                         ImWchar const*)
+{
+    return add_font (atlas, size);
+}
+
+/// The style of ImGui dark colors, the ones used here
+void
+init_context ()
+{
+    auto& s = g.style;
+    s.Alpha = 1;
+    s.WindowPadding = { 8, 8 };
+    s.WindowBorderSize = 1;
+    s.WindowMinSize = { 32, 32 };
+    s.PopupBorderSize = 1;
+    s.FramePadding = { 4, 3 };
+    s.ItemSpacing = { 8, 4 };
+    s.ItemInnerSpacing = { 4, 4 };
+    s.IndentSpacing = 21;
+    s.ScrollbarSize = 14;
+    s.GrabMinSize = 10;
+    s.AntiAliasedLines = s.AntiAliasedLinesUseTex = s.AntiAliasedFill = true;
+    s.CurveTessellationTol = 1.25f;
+    s.CircleTessellationMaxError = .3f;
+    for (auto& c: s.Colors)
+        c = ImVec4 { .16f, .29f, .48f, .54f };
+    s.Colors[ImGuiCol_Text] = { 1, 1, 1, 1 };
+    s.Colors[ImGuiCol_TextDisabled] = { .5f, .5f, .5f, 1 };
+    s.Colors[ImGuiCol_WindowBg] = { .06f, .06f, .06f, .94f };
+    s.Colors[ImGuiCol_PopupBg] = { .08f, .08f, .08f, .94f };
+    s.Colors[ImGuiCol_Border] = { .43f, .43f, .5f, .5f };
+    s.Colors[ImGuiCol_TitleBgActive] = { .16f, .29f, .48f, 1 };
+    s.Colors[ImGuiCol_Separator] = { .43f, .43f, .5f, .5f };
+    s.Colors[ImGuiCol_PlotLines] = { .61f, .61f, .61f, 1 };
+
+    g.io.Fonts = &g.atlas;
+    g.io.FontGlobalScale = 1;
+    g.io.DisplaySize = { 1920, 1080 };
+    g.io.MousePos = { -FLT_MAX, -FLT_MAX };
+    g.io.BackendFlags = ImGuiBackendFlags_RendererHasVtxOffset;
+
+    g.atlas.TexID = &font_texture;
+    g.atlas.TexWidth = 512, g.atlas.TexHeight = 64;
+    g.atlas.TexUvScale = { 1.f / 512, 1.f / 64 };
+    g.atlas.TexUvWhitePixel = { .5f / 512, .5f / 64 };
+    for (int w = 0; w < 64; ++w)
+    {
+        float const y = (float (w) + .5f) / 64;
+        g.atlas.TexUvLines[w] = ImVec4 { 1.f / 512, y, float (w + 3) / 512, y };
+    }
+
+    g.shared.TexUvWhitePixel = g.atlas.TexUvWhitePixel;
+    g.shared.TexUvLines = g.atlas.TexUvLines;
+    g.shared.CurveTessellationTol = s.CurveTessellationTol;
+    g.shared.CircleSegmentMaxError = s.CircleTessellationMaxError;
+    g.shared.ClipRectFullscreen = { -8192, -8192, 8192, 8192 };
+    g.shared.InitialFlags = ImDrawListFlags_AntiAliasedLines | ImDrawListFlags_AntiAliasedLinesUseTex
+                          | ImDrawListFlags_AntiAliasedFill | ImDrawListFlags_AllowVtxOffset;
+
+    g.viewport.Size = g.viewport.WorkSize = g.io.DisplaySize;
+    g.viewport.DpiScale = 1;
+    g.viewport.PlatformHandle = &g.viewport;
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+imgui_api SSEIMGUI_CCONV
+make_recording_imgui ()
+{
+    static bool once = (init_context (), true);
+    (void) once;
+
+    imgui_api t = {};
+    t.igBegin = ig_begin;
+    t.igEnd = ig_end;
+    t.igSetNextWindowSize = ig_set_next_window_size;
+    t.igOpenPopup_Str = ig_open_popup;
+    t.igBeginPopup = ig_begin_popup;
+    t.igEndPopup = ig_end_popup;
+    t.igCloseCurrentPopup = ig_close_current_popup;
+    t.igBeginTooltip = ig_begin_tooltip;
+    t.igEndTooltip = ig_end_tooltip;
+
+    t.igText = ig_text;
+    t.igTextDisabled = ig_text_disabled;
+    t.igTextUnformatted = ig_text_unformatted;
+    t.igButton = ig_button;
+    t.igInvisibleButton = ig_invisible_button;
+    t.igCheckbox = ig_checkbox;
+    t.igRadioButton_Bool = ig_radio_button;
+    t.igSliderFloat = ig_slider_float;
+    t.igSliderInt = ig_slider_int;
+    t.igDragFloat = ig_drag_float;
+    t.igDragInt = ig_drag_int;
+    t.igColorEdit4 = ig_color_edit4;
+    t.igInputText = ig_input_text;
+    t.igCombo_FnBoolPtr = ig_combo;
+    t.igListBox_FnBoolPtr = ig_list_box;
+    t.igPlotLines_FnFloatPtr = ig_plot_lines;
+    t.igSeparator = ig_separator;
+    t.igDummy = ig_dummy;
+    t.igSameLine = ig_same_line;
+    t.igBeginGroup = ig_begin_group;
+    t.igEndGroup = ig_end_group;
+    t.igIsItemHovered = ig_is_item_hovered;
+    t.igSetNextItemWidth = ig_set_next_item_width;
+
+    t.igGetIO = ig_get_io;
+    t.igGetStyle = ig_get_style;
+    t.igGetMainViewport = ig_get_main_viewport;
+    t.igGetDrawListSharedData = ig_get_draw_list_shared_data;
+    t.igGetWindowDrawList = ig_get_window_draw_list;
+    t.igGetFontSize = ig_get_font_size;
+    t.igGetWindowHeight = ig_get_window_height;
+    t.igGetTextLineHeightWithSpacing = ig_get_text_line_height_with_spacing;
+    t.igGetFontTexUvWhitePixel = ig_get_font_tex_uv_white_pixel;
+    t.igGetWindowPos = ig_get_window_pos;
+    t.igGetCursorPos = ig_get_cursor_pos;
+    t.igGetContentRegionAvail = ig_get_content_region_avail;
+    t.igCalcTextSize = ig_calc_text_size;
+    t.igGetColorU32_Vec4 = ig_get_color_u32;
+    t.igColorConvertU32ToFloat4 = ig_color_convert_u32_to_float4;
+    t.igPushStyleColor_Vec4 = ig_push_style_color;
+    t.igPopStyleColor = ig_pop_style_color;
+    t.igPushStyleVar_Float = ig_push_style_var_float;
+    t.igPushStyleVar_Vec2 = ig_push_style_var_vec2;
+    t.igPopStyleVar = ig_pop_style_var;
+    t.igPushFont = ig_push_font;
+    t.igPopFont = ig_pop_font;
+    t.igPushTextWrapPos = ig_push_text_wrap_pos;
+    t.igPopTextWrapPos = ig_pop_text_wrap_pos;
+
+    t.ImDrawList_ImDrawList = dl_make;
+    t.ImDrawList__ResetForNewFrame = dl_reset_for_new_frame;
+    t.ImDrawList_PushClipRect = dl_push_clip_rect;
+    t.ImDrawList_PushClipRectFullScreen = dl_push_clip_rect_full_screen;
+    t.ImDrawList_PopClipRect = dl_pop_clip_rect;
+    t.ImDrawList_PushTextureID = dl_push_texture_id;
+    t.ImDrawList_PopTextureID = dl_pop_texture_id;
+    t.ImDrawList_PrimReserve = dl_prim_reserve_counted;
+    t.ImDrawList_AddImage = dl_add_image;
+    t.ImDrawList_AddCircleFilled = dl_add_circle_filled;
+    t.ImDrawList_AddText_Vec2 = dl_add_text;
+    t.ImDrawList_AddText_FontPtr = dl_add_text_font;
+
+    t.ImFontAtlas_AddFontFromFileTTF = ig_add_font_from_file;
+    t.ImFontAtlas_AddFontFromMemoryCompressedBase85TTF = ig_add_font_from_base85;
+    return t;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void
+recording_new_frame (recording_input const& in, float delta_time)
+{
+    assert (g.stack.empty () && g.colors.empty () && g.vars.empty () && g.wraps.empty ());
+    assert (g.font_stack.size () == 1);
+
+    auto& io = g.io;
+    io.DisplaySize = g.viewport.Size = g.viewport.WorkSize = in.display_size;
+    io.DeltaTime = delta_time;
+    io.MousePos = in.mouse_pos;
+    io.MouseDelta = g.mouse_prev_pos.x < 0 || in.mouse_pos.x < 0 ? ImVec2 {}
+                  : in.mouse_pos - g.mouse_prev_pos;
+    g.mouse_prev_pos = in.mouse_pos;
+    for (int k = 0; k < 2; ++k)
+    {
+        io.MouseDown[k] = in.mouse_down[k];
+        io.MouseClicked[k] = in.mouse_down[k] && !g.mouse_prev[k];
+        io.MouseReleased[k] = !in.mouse_down[k] && g.mouse_prev[k];
+        if (io.MouseClicked[k])
+            io.MouseClickedPos[k] = in.mouse_pos;
+        g.mouse_prev[k] = in.mouse_down[k];
+    }
+    io.MouseWheel = in.mouse_wheel;
+
+    // Over the windows of the last frame, the last drawn on top
+    g.hovered_window = nullptr;
+    for (auto it = g.last_order.rbegin (); it != g.last_order.rend (); ++it)
+        if (!(*it)->tooltip && contains ((*it)->rect (), io.MousePos))
+        {
+            g.hovered_window = *it;
+            break;
+        }
+
+    // A click closes the popups above the one it is in
+    if (io.MouseClicked[0] || io.MouseClicked[1])
+    {
+        std::size_t keep = 0;
+        for (std::size_t k = 0; k < g.popups.size (); ++k)
+        {
+            char name[32];
+            std::snprintf (name, sizeof name, "##Popup_%08x", g.popups[k].id);
+            auto it = g.windows.find (name);
+            if (it != g.windows.end () && it->second.get () == g.hovered_window)
+                keep = k + 1;
+        }
+        g.popups.resize (keep);
+    }
+
+    if (!g.active_seen)
+        g.active_id = 0;
+    g.active_seen = false;
+    g.items.clear ();
+    g.stats = {};
+    g.shared.Font = current_font ();
+    g.shared.FontSize = font_size ();
+}
+
+recording_stats
+recording_end_frame ()
+{
+    auto s = g.stats;
+    s.windows = int (g.order.size ());
+    for (auto w: g.order)
+    {
+        auto const dl = w->list;
+        s.vertices += dl->VtxBuffer.Size;
+        s.triangles += dl->IdxBuffer.Size / 3;
+        unsigned elements = 0;
+        for (int k = 0; k < dl->CmdBuffer.Size; ++k)
+        {
+            auto const& c = dl->CmdBuffer.Data[k];
+            if (!c.ElemCount)
+                continue;
+            ++s.draw_calls;
+            elements += c.ElemCount;
+            for (auto i = dl->IdxBuffer.Data + c.IdxOffset, e = i + c.ElemCount; i != e; ++i)
+                s.bad_indices += c.VtxOffset + *i >= unsigned (dl->VtxBuffer.Size);
+        }
+        s.bad_indices += int (unsigned (dl->IdxBuffer.Size) - elements);
+    }
+    g.last_order.swap (g.order);
+    g.order.clear ();
+    g.last_items.swap (g.items);
+    ++g.frame;
+    return s;
+}
+
+void
+recording_place_window (std::string const& name, ImVec2 const& pos, ImVec2 const& size)
+{
+    auto& w = find_window (name);
+    w.pos = pos, w.size = size;
+    w.placed = true;
+}
+
+bool
+recording_item_rect (std::string const& label, ImVec4& rect)
+{
+    auto it = g.last_items.find (label);
+    if (it == g.last_items.end ())
+        return false;
+    rect = it->second;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,75 @@
+/**
+ * @file recording_imgui.hpp
+ * @brief Headless ImGui table which records the draw lists of a frame, for the benchmarks
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Only the entries of #imgui_api which the plugin calls are set, the rest are null so that a call
+ * to anything else faults at once. The draw lists follow ImGui 1.84: the same commands split on
+ * the same header changes, the same vertex offsets past 64k vertices, and the same vertex and
+ * index counts for the images, text, filled circles and anti-aliased lines. The windows and the
+ * widgets are laid out as ImGui does, by the cursor of their window, with the hover, click and
+ * drag of the mouse, though only as much of their look as gives about the same geometry.
+ */
+
+#ifndef BENCH_RECORDING_IMGUI_HPP
+#define BENCH_RECORDING_IMGUI_HPP
+
+#include <sse-imgui/imgui_wrapped.h>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Of a frame, as a platform backend would feed it
+struct recording_input
+{
+    ImVec2 display_size { 1920, 1080 };
+    ImVec2 mouse_pos { -1, -1 };
+    bool mouse_down[2] = {};
+    float mouse_wheel = 0;
+};
+
+/// What a frame left to be drawn, over all of its windows. The primitives are the ones added by
+/// the plugin itself, the reserves being its own triangles.
+struct recording_stats
+{
+    int windows, draw_calls, vertices, triangles;
+    int images, glyphs, circles, reserves;
+    int bad_indices;    ///< Out of the vertices of their command, always none unless a bug
+};
+
+/// The table of the entries emulated, for sseimgui_api#make_imgui_api
+imgui_api SSEIMGUI_CCONV make_recording_imgui ();
+
+void recording_new_frame (recording_input const& input, float delta_time);
+recording_stats recording_end_frame ();
+
+/// Places a window as if moved and resized by the user, made if not yet
+void recording_place_window (std::string const& name, ImVec2 const& pos, ImVec2 const& size);
+
+/// Screen rectangle of an item of the last frame, by its label (e.g. "Clear##track"). The items
+/// of the combo and list boxes are their label with "/" and their index.
+bool recording_item_rect (std::string const& label, ImVec4& rect);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
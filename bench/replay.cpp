@@ -0,0 +1,380 @@
+/**
+ * @file replay.cpp
+ * @brief Replays the rendering of the plugin on a script of viewport, zoom and input
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: replay [script] [icons]
+ *
+ * The plugin is loaded in a fresh temporary directory, with as many icons as asked (50000 by
+ * default) spread over the map, some of them in clusters. The player walks from a fixed seed, a
+ * point a tick. Without a script the built-in one below is run: a track of a million points, the
+ * map idle, recording, zoomed in, panned and with the menu open. A script has a command a line:
+ *
+ *     viewport W H             display size
+ *     window X Y W H NAME      places the window NAME as if by the user
+ *     ticks N                  runs the timer of the plugin N times, the player a step further
+ *     tick_every K             runs the timer too on every K-th frame, 0 for never
+ *     frames N                 renders N frames
+ *     settle                   renders until the jobs of the plugin are all done
+ *     mouse X Y                moves the mouse
+ *     hover LABEL              moves the mouse to the middle of an item of the last frame
+ *     zoom N                   turns the wheel a notch a frame, for N frames, out if negative
+ *     drag DX DY N             drags the mouse by DX, DY over N frames
+ *     click LABEL              clicks an item of the last frame, over two frames
+ *     report TITLE             prints the frames since the last report
+ *
+ * and the lines starting with '#' are comments. The frame time is the one of the render callback
+ * alone, as SSE ImGui would call it, with the geometry left in the draw lists of all windows.
+ *
+ * This file builds src/render.cpp as its own part, to reach its map layers and caches.
+ */
+
+#include "render.cpp"
+
+#include "platform.hpp"
+#include "recording_imgui.hpp"
+#include "walk.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace bench {
+
+constexpr char const* builtin_script = R"(
+viewport 1920 1080
+window 40 20 1500 1000 SSE MapTrack
+ticks 1000000
+settle
+frames 300
+report idle, whole map
+tick_every 1
+frames 300
+report recording, whole map
+tick_every 0
+hover Map
+zoom 40
+frames 100
+report zoomed in
+drag 300 200 60
+frames 100
+report panned
+zoom -40
+frames 50
+click <<##Menu
+frames 200
+report menu open
+)";
+
+/// The player, walking about the map from a fixed seed with a teleport once in a while
+struct walker
+{
+    walk path;
+
+    void step ()
+    {
+        auto const p = path.step ();
+        auto& g = game ();
+        g.position[0] = p.x, g.position[1] = p.y, g.position[2] = p.z;
+        g.time = p.w;
+    }
+};
+
+/// Icons of a default size over the map, half of them around a few hundred places
+void
+write_icons (std::filesystem::path const& file, int count)
+{
+    std::mt19937 rng { 4321 };
+    std::uniform_real_distribution<float> u (0, 1);
+    std::normal_distribution<float> n (0, 4000);
+    float const half = icon_atlas_t::default_uvsize * .5f * 2048 * 205;
+    std::vector<glm::vec2> places (300);
+    for (auto& p: places)
+        p = { (u (rng) * 2 - 1) * 180000, (u (rng) * 2 - 1) * 130000 };
+
+    nlohmann::json icons = nlohmann::json::object ();
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec2 p { (u (rng) * 2 - 1) * 180000, (u (rng) * 2 - 1) * 130000 };
+        if (i % 2)
+            p = places[std::size_t (i / 2) % places.size ()] + glm::vec2 { n (rng), n (rng) };
+        icons[std::to_string (i)] = {
+            { "index", i % 3509 },
+            { "tint", "0xFFFFFFFF" },
+            { "text", "Icon " + std::to_string (i) },
+            { "aabb", { p.x - half, p.y + half, p.x + half, p.y - half } }
+        };
+    }
+    nlohmann::json json = { { "icons", icons } };
+    save_json (json, file);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+struct replay
+{
+    walker player;
+    recording_input input;
+    int tick_every = 0;
+    std::uint64_t frame = 0;
+
+    /// Since the last report
+    std::vector<double> times;
+    recording_stats sum = {};
+    recording_stats last = {};
+    decltype (map_layers) layers0 = map_layers;
+    decltype (fog_cache) fog0 = fog_cache;
+    std::uint64_t messages0 = 0;
+
+    void run_frame ()
+    {
+        if (tick_every && frame % std::uint64_t (tick_every) == 0)
+        {
+            player.step ();
+            game_tick ();
+        }
+        recording_new_frame (input, 1.f / 60);
+        auto const start = std::chrono::steady_clock::now ();
+        render_frame ();
+        auto const t = std::chrono::duration<double, std::milli> (
+                std::chrono::steady_clock::now () - start).count ();
+        last = recording_end_frame ();
+        if (last.bad_indices)
+        {
+            std::fprintf (stderr, "frame %llu: %d indices out of their vertices\n",
+                          (unsigned long long) frame, last.bad_indices);
+            std::exit (1);
+        }
+        times.push_back (t);
+        for (auto [s, l]: { std::pair { &sum.windows, last.windows },
+                { &sum.draw_calls, last.draw_calls }, { &sum.vertices, last.vertices },
+                { &sum.triangles, last.triangles }, { &sum.images, last.images },
+                { &sum.glyphs, last.glyphs }, { &sum.circles, last.circles },
+                { &sum.reserves, last.reserves } })
+            *s += l;
+        input.mouse_wheel = 0;
+        ++frame;
+    }
+
+    ImVec2 item_center (std::string const& label)
+    {
+        ImVec4 r;
+        if (!recording_item_rect (label, r))
+        {
+            std::fprintf (stderr, "No item \"%s\" in the last frame\n", label.c_str ());
+            std::exit (1);
+        }
+        return ImVec2 { (r.x + r.z) * .5f, (r.y + r.w) * .5f };
+    }
+
+    void report (std::string const& title)
+    {
+        if (times.empty ())
+            return;
+        auto sorted = times;
+        std::sort (sorted.begin (), sorted.end ());
+        double mean = 0;
+        for (auto t: times)
+            mean += t;
+        mean /= double (times.size ());
+        auto pct = [&] (double p) { return sorted[std::size_t (p * double (sorted.size () - 1))]; };
+        auto const n = int (times.size ());
+
+        std::printf ("== %s: %d frames, %zu points, %zu icons\n", title.c_str (), n,
+                     maptrack.track.size (), maptrack.icons.size ());
+        std::printf ("   frame ms: mean %.3f  p50 %.3f  p99 %.3f  max %.3f\n",
+                     mean, pct (.5), pct (.99), sorted.back ());
+        std::printf ("   per frame: %d windows  %d draw calls  %d vertices  %d triangles\n",
+                     sum.windows / n, sum.draw_calls / n, sum.vertices / n, sum.triangles / n);
+        std::printf ("   plugin primitives: %d images  %d glyphs  %d circles  %d reserves\n",
+                     sum.images / n, sum.glyphs / n, sum.circles / n, sum.reserves / n);
+        for (auto const l: recorded_layer::layers ())
+        {
+            auto const g = l->last_geometry ();
+            std::printf ("   layer %-8s %6d draw calls %9d vertices %9d triangles"
+                         "  recorded in %.3f ms\n", l->label (), g.draw_calls, g.vertices,
+                         g.triangles, l->mean_record_time () * 1e3);
+        }
+        auto const recorded = map_layers.recorded - layers0.recorded;
+        auto const spliced = map_layers.spliced - layers0.spliced;
+        std::printf ("   layers: %llu recorded (%.3f ms each), %llu spliced (%.3f ms each)\n",
+                     (unsigned long long) recorded,
+                     recorded ? (map_layers.record_time - layers0.record_time) * 1e3 / double (recorded) : 0.,
+                     (unsigned long long) spliced,
+                     spliced ? (map_layers.splice_time - layers0.splice_time) * 1e3 / double (spliced) : 0.);
+        std::printf ("   fog: %llu reused, %llu moved, %llu rebuilt; %llu messages sent\n",
+                     (unsigned long long) (fog_cache.reused - fog0.reused),
+                     (unsigned long long) (fog_cache.moved - fog0.moved),
+                     (unsigned long long) (fog_cache.rebuilt - fog0.rebuilt),
+                     (unsigned long long) (dispatched_messages () - messages0));
+        std::fflush (stdout);
+
+        times.clear ();
+        sum = {};
+        layers0 = map_layers;
+        fog0 = fog_cache;
+        messages0 = dispatched_messages ();
+    }
+
+    void command (std::string const& line)
+    {
+        std::istringstream is (line);
+        std::string op;
+        if (!(is >> op) || op[0] == '#')
+            return;
+        auto rest = [&is] {
+            std::string s;
+            std::getline (is >> std::ws, s);
+            return s;
+        };
+
+        if (op == "viewport")
+            is >> input.display_size.x >> input.display_size.y;
+        else if (op == "window")
+        {
+            ImVec2 pos, size;
+            is >> pos.x >> pos.y >> size.x >> size.y;
+            recording_place_window (rest (), pos, size);
+        }
+        else if (op == "ticks")
+        {
+            long n = 0;
+            is >> n;
+            for (long i = 0; i < n; ++i)
+                player.step (), game_tick ();
+        }
+        else if (op == "tick_every")
+            is >> tick_every;
+        else if (op == "frames")
+        {
+            int n = 0;
+            is >> n;
+            for (int i = 0; i < n; ++i)
+                run_frame ();
+        }
+        else if (op == "settle")
+        {
+            run_frame ();
+            while (!maptrack.jobs.empty ())
+                run_frame ();
+            std::printf ("-- settled after %zu frames\n", times.size ());
+            times.clear ();
+            sum = {};
+        }
+        else if (op == "mouse")
+            is >> input.mouse_pos.x >> input.mouse_pos.y;
+        else if (op == "hover")
+            input.mouse_pos = item_center (rest ());
+        else if (op == "zoom")
+        {
+            int n = 0;
+            is >> n;
+            for (int i = 0; i < std::abs (n); ++i)
+            {
+                input.mouse_wheel = n > 0 ? 1.f : -1.f;
+                run_frame ();
+            }
+        }
+        else if (op == "drag")
+        {
+            float dx = 0, dy = 0;
+            int n = 1;
+            is >> dx >> dy >> n;
+            input.mouse_down[0] = true;
+            run_frame ();
+            for (int i = 0; i < n; ++i)
+            {
+                input.mouse_pos.x += dx / float (n), input.mouse_pos.y += dy / float (n);
+                run_frame ();
+            }
+            input.mouse_down[0] = false;
+            run_frame ();
+        }
+        else if (op == "click")
+        {
+            auto const back = input.mouse_pos;
+            input.mouse_pos = item_center (rest ());
+            run_frame ();
+            input.mouse_down[0] = true;
+            run_frame ();
+            input.mouse_down[0] = false;
+            run_frame ();
+            input.mouse_pos = back;
+        }
+        else if (op == "report")
+            report (rest ());
+        else
+        {
+            std::fprintf (stderr, "Unknown command: %s\n", line.c_str ());
+            std::exit (1);
+        }
+    }
+};
+
+} // namespace bench
+
+//--------------------------------------------------------------------------------------------------
+
+int
+main (int argc, char** argv)
+{
+    std::string script = bench::builtin_script;
+    if (argc > 1)
+    {
+        std::ifstream fi (argv[1]);
+        if (!fi)
+        {
+            std::fprintf (stderr, "Unable to read %s\n", argv[1]);
+            return 1;
+        }
+        script.assign (std::istreambuf_iterator<char> (fi), {});
+    }
+    int const icons = argc > 2 ? std::atoi (argv[2]) : 50000;
+
+    // The plugin writes its settings and tracks next to it
+    char dir[] = "/tmp/maptrack-replay-XXXXXX";
+    if (!::mkdtemp (dir) || ::chdir (dir))
+    {
+        std::perror ("Unable to make a working directory");
+        return 1;
+    }
+    bench::write_icons (default_icons_file, icons);
+    if (!load_plugin ())
+    {
+        std::fprintf (stderr, "The plugin did not load, see %s/%s.log\n", dir,
+                      plugin_name ().c_str ());
+        return 1;
+    }
+
+    bench::replay r;
+    std::istringstream is (script);
+    for (std::string line; std::getline (is, line); )
+        r.command (line);
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+/**
+ * @file d3d11.h
+ * @brief The texture queries the sources use, for the benchmarks on POSIX
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * A texture is only its size, which the views made by the stubbed SSE ImGui point to.
+ */
+
+#ifndef BENCH_D3D11_H
+#define BENCH_D3D11_H
+
+#include <windows.h>
+
+//--------------------------------------------------------------------------------------------------
+
+struct D3D11_TEXTURE2D_DESC
+{
+    UINT Width, Height;
+};
+
+struct ID3D11Texture2D;
+
+struct ID3D11Resource
+{
+    UINT width, height;
+
+    void Release () {}
+
+    template<class T> HRESULT QueryInterface (T** out)
+    {
+        *out = static_cast<T*> (this);
+        return S_OK;
+    }
+};
+
+struct ID3D11Texture2D : ID3D11Resource
+{
+    void GetDesc (D3D11_TEXTURE2D_DESC* d) const
+    {
+        d->Width = width;
+        d->Height = height;
+    }
+};
+
+struct ID3D11ShaderResourceView
+{
+    ID3D11Texture2D* texture;
+
+    void GetResource (ID3D11Resource** out) const { *out = texture; }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
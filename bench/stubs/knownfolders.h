@@ -0,0 +1,37 @@
+/**
+ * @file knownfolders.h
+ * @brief The known folders the sources use, for the benchmarks on POSIX
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ */
+
+#ifndef BENCH_KNOWNFOLDERS_H
+#define BENCH_KNOWNFOLDERS_H
+
+#include <shlobj.h>
+
+//--------------------------------------------------------------------------------------------------
+
+extern KNOWNFOLDERID const FOLDERID_Documents;
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * @file shlobj.h
+ * @brief The shell folder lookup the sources use, for the benchmarks on POSIX
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ */
+
+#ifndef BENCH_SHLOBJ_H
+#define BENCH_SHLOBJ_H
+
+#include <windows.h>
+
+//--------------------------------------------------------------------------------------------------
+
+struct GUID
+{
+    std::uint32_t data1;
+    std::uint16_t data2, data3;
+    std::uint8_t data4[8];
+};
+
+typedef GUID KNOWNFOLDERID;
+typedef KNOWNFOLDERID const& REFKNOWNFOLDERID;
+
+/// Fails, so that the log goes to the working directory
+HRESULT SHGetKnownFolderPath (REFKNOWNFOLDERID rfid, DWORD flags, HANDLE token, PWSTR* path);
+
+void CoTaskMemFree (void* p);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
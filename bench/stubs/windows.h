@@ -0,0 +1,95 @@
+/**
+ * @file windows.h
+ * @brief The few Windows declarations the sources use, for the benchmarks on POSIX
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Only what is reached from src/ and share/utils/ outside skse.cpp and winutils.cpp. These are
+ * implemented over POSIX in bench/platform.cpp.
+ */
+
+#ifndef BENCH_WINDOWS_H
+#define BENCH_WINDOWS_H
+
+#include <cstdint>
+#include <cwchar>
+
+//--------------------------------------------------------------------------------------------------
+
+typedef wchar_t TCHAR;
+typedef unsigned long DWORD;
+typedef unsigned UINT;
+typedef std::uintptr_t UINT_PTR;
+typedef long HRESULT;
+typedef wchar_t* PWSTR;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HMODULE;
+typedef void VOID;
+
+#define CALLBACK
+#define NTDDI_VISTA 0x06000000
+
+#define S_OK 0
+#define E_FAIL ((HRESULT) 0x80004005L)
+#define SUCCEEDED(hr) (HRESULT (hr) >= 0)
+
+#define CP_UTF8 65001
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_NO_MORE_FILES 18
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define INVALID_FILE_ATTRIBUTES (DWORD (-1))
+#define INVALID_HANDLE_VALUE (HANDLE (std::intptr_t (-1)))
+
+//--------------------------------------------------------------------------------------------------
+
+int MultiByteToWideChar (UINT code_page, DWORD flags, char const* bytes, int bytes_size,
+                         wchar_t* wide, int wide_size);
+int WideCharToMultiByte (UINT code_page, DWORD flags, wchar_t const* wide, int wide_size,
+                         char* bytes, int bytes_size, char const* default_char, int* used_default);
+
+DWORD GetLastError ();
+
+/// The image of the game, as mocked for the relocations
+HMODULE GetModuleHandle (wchar_t const* name);
+
+DWORD GetFileAttributesW (wchar_t const* name);
+
+struct WIN32_FIND_DATA
+{
+    DWORD dwFileAttributes;
+    wchar_t cFileName[260];
+};
+
+HANDLE FindFirstFile (wchar_t const* wildcard, WIN32_FIND_DATA* data);
+int FindNextFile (HANDLE h, WIN32_FIND_DATA* data);
+int FindClose (HANDLE h);
+
+typedef VOID (CALLBACK* TIMERPROC) (HWND, UINT, UINT_PTR, DWORD);
+
+/// Keeps the callback, for the benchmark to run as the game would on its period
+UINT_PTR SetTimer (HWND hwnd, UINT_PTR id, UINT elapse, TIMERPROC callback);
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * @file thread_scaling.cpp
+ * @brief Scaling of the track passes run on the worker threads, from one thread to all the cores
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: thread_scaling [points] [threads]
+ *
+ * The track is the synthetic walk, 1M points by default, as the whole range. The pool of the
+ * render thread is put in place with 1 thread up to as many as the host has cores, and at least
+ * the 4 the plugin takes by default, then each pass is timed as the plugin runs it:
+ *
+ *  - the projection and tessellation of the screen track, of every point as at the finest level
+ *    of detail, though its store is read on the calling thread alone
+ *  - the stamping of the fog of war cells, by bands of rows, at a resolution of 1024
+ *  - the speeds of the track summary, by a reduction over a part of the range for each thread
+ *
+ * The length of the range is not threaded, as it is read in constant time from the cumulative
+ * distances. The threads past the cores of the host only share them, which the output tells. The
+ * vertices, the cells and the speeds made are checked to be the same at any thread count.
+ *
+ * This file builds src/render.cpp as its own part, to reach its worker pool and passes.
+ */
+
+#include "render.cpp"
+
+#include "walk.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+/// Median time of @p f in milliseconds
+template<class F>
+double
+time_ms (F&& f, int runs = 7)
+{
+    std::vector<double> t (runs);
+    for (auto& v: t)
+    {
+        auto const a = std::chrono::steady_clock::now ();
+        f ();
+        v = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - a)
+            .count ();
+    }
+    std::nth_element (t.begin (), t.begin () + runs / 2, t.end ());
+    return t[runs / 2];
+}
+
+/// Of the results only summed up, so that their passes are not optimized out
+volatile double sink;
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::size_t const n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 1'000'000;
+    unsigned const cores = std::thread::hardware_concurrency ();
+    unsigned const most = argc > 2 ? unsigned (std::atoi (argv[2])) : std::max (cores, 4u);
+
+    // The default map of fileio.cpp
+    maptrack.offset = { .4766f, .3760f };
+    maptrack.scale = { 1.f/(2048*205), 1.f/(2048*205) };
+    maptrack.track.merge_distance (0);
+    bench::walk w;
+    for (std::size_t i = 0; i < n; ++i)
+        maptrack.track.add_point (w.step ());
+    while (maptrack.track.seal_next ())
+        ;
+    bool updated;
+    auto const all = maptrack.track.time_range (
+            maptrack.track.begin ()->w, maptrack.track.last_time (), updated);
+    track_range.first = all.first, track_range.second = all.second;
+
+    // The window of the replay, over the whole map
+    glm::vec2 const wpos (40, 20), wsz (1500, 1000), uvtl (0), uvbr (1);
+    map_project const proj (wpos, wsz, uvtl, uvbr);
+    line_style const line { 3, 0xFF400000, false, { 0, 0, 0, 0 } };
+    float const far = std::numeric_limits<float>::max ();
+    glm::vec2 const lo (-far), hi (far);
+
+    constexpr int resolution = 1024;
+    glm::vec2 const step (1.f / resolution);
+
+    double const length = bench::time_ms ([&] {
+        bench::sink = track_t::compute_length (all.first, all.second);
+    }) * 1e6;
+    std::printf ("== %zu points, %u cores on this host, 1 to %u threads\n", n, cores, most);
+    std::printf ("   length: %.0f ns at any thread count, from the cumulative distances\n",
+                 length);
+    std::printf ("   %7s %19s %19s %19s\n", "threads", "project+tessellate", "fog stamping",
+                 "speeds reduce");
+
+    double base[3] = {};
+    std::size_t results[3] = {};        // Of the single thread, the others make the same
+    bool differ = false;
+    for (unsigned k = 1; k <= most; ++k)
+    {
+        delete worker_pool;
+        worker_pool = new thread_pool (k - 1);
+
+        screen_track track;
+        std::size_t vertices = 0;
+        double const project = bench::time_ms ([&] {
+            track.clear (wpos, line);
+            track.update (all.first, all.second, 0, std::numeric_limits<std::size_t>::max (),
+                          lo, hi, proj);
+            vertices = 0;
+            for (auto const& s: track.spans)
+                vertices += s.vertices.size ();
+        });
+
+        fog_grid fog;
+        std::size_t tracked = 0;
+        double const stamp = bench::time_ms ([&] {
+            fog.reset (resolution, 4, 255, 128, 0, 450, all.first.position ());
+            stamp_fog_grid (fog, step, n);
+            tracked = std::size_t (std::count (fog.tracked.cbegin (), fog.tracked.cend (), 1));
+        });
+
+        // As the job of draw_track_summary() does, in a single step
+        struct partial
+        {
+            std::vector<float> speeds;
+            float lo = std::numeric_limits<float>::max (), hi = 0;
+        };
+        std::size_t speeds = 0;
+        double const reduce = bench::time_ms ([&] {
+            auto const parts = workers ().size ();
+            auto r = workers ().parallel_reduce (0, n, parts, partial {},
+                    [&] (std::size_t a, std::size_t b)
+            {
+                partial p;
+                float plo, phi;
+                track_t::compute_speeds (all.first + a, all.first + b + (b != n),
+                                         p.speeds, plo, phi);
+                if (!p.speeds.empty ())
+                    p.lo = plo, p.hi = phi;
+                return p;
+            },
+                    [] (partial a, partial b)
+            {
+                a.speeds.insert (a.speeds.end (), b.speeds.cbegin (), b.speeds.cend ());
+                a.lo = std::min (a.lo, b.lo), a.hi = std::max (a.hi, b.hi);
+                return a;
+            });
+            speeds = r.speeds.size ();
+        });
+
+        double const t[3] = { project, stamp, reduce };
+        std::size_t const r[3] = { vertices, tracked, speeds };
+        if (k == 1)
+            std::copy_n (t, 3, base), std::copy_n (r, 3, results);
+        differ |= !std::equal (r, r + 3, results);
+        std::printf ("   %7u", k);
+        for (int j = 0; j < 3; ++j)
+            std::printf (" %9.2f ms %5.2fx", t[j], base[j] / t[j]);
+        std::printf ("%s\n", k > cores ? "  (more threads than cores)" : "");
+    }
+    if (differ)
+        std::fprintf (stderr, "The threads made other vertices, cells or speeds than one alone\n");
+    return differ;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,156 @@
+/**
+ * @file track_append.cpp
+ * @brief Latency of appending points to the track, against the vector the track used to be
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: track_append [points...]
+ *
+ * Each call of track_t::add_point() is timed on its own, as the timer of the plugin makes them,
+ * for 1M and 10M points of the synthetic walk by default. The former store, a std::vector of
+ * glm::vec4 growing by push_back, is timed the same way on the same points. The worst case is
+ * the one which stalls a frame, though on a loaded host it is as much the scheduler as the store:
+ * the 99th and 99.9th percentiles and the calls past 100 us tell the two apart.
+ *
+ * The appends leave the full blocks open, the plugin packs them later in a job, one per step.
+ * These steps are timed too, each one as a call of track_t::seal_next().
+ */
+
+#include "track.hpp"
+#include "walk.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+/// Prints the latencies @p us in microseconds, of calls which took @p total ms together
+void
+report (char const* name, std::vector<float>& us, double total)
+{
+    if (us.empty ())
+        return;
+    double sum = 0;
+    std::size_t slow = 0;
+    for (auto t: us)
+        sum += t, slow += t > 100;
+    auto const k1 = us.size () - 1 - us.size () / 100, k2 = us.size () - 1 - us.size () / 1000;
+    std::nth_element (us.begin (), us.begin () + k1, us.end ());
+    float const p99 = us[k1];
+    std::nth_element (us.begin () + k1, us.begin () + k2, us.end ());
+    float const p999 = us[k2];
+    float const worst = *std::max_element (us.begin () + k2, us.end ());
+    std::printf ("   %-28s worst %8.1f us  p99 %6.2f us  p99.9 %6.2f us  mean %6.3f us"
+                 "  >100us %4zu  total %7.1f ms\n",
+                 name, worst, p99, p999, sum / double (us.size ()), slow, total);
+}
+
+/// Microseconds since @p a
+float
+since (std::chrono::steady_clock::time_point a)
+{
+    return std::chrono::duration<float, std::micro> (std::chrono::steady_clock::now () - a).count ();
+}
+
+/// Times each call of add_point() and each of the seal_next() steps run between them, when
+/// blocks were left open, as the packing job of the plugin runs between two timer ticks. False
+/// when the track does not end up with all the points.
+bool
+time_track (std::vector<glm::vec4> const& points)
+{
+    track_t track;
+    track.merge_distance (0);
+    std::vector<float> us (points.size ()), seal;
+    double total = 0, sealing = 0;
+    for (std::size_t i = 0; i < points.size (); ++i)
+    {
+        auto const a = std::chrono::steady_clock::now ();
+        track.add_point (points[i]);
+        total += us[i] = since (a);
+        while (track.unsealed ())
+        {
+            auto const b = std::chrono::steady_clock::now ();
+            track.seal_next ();
+            sealing += seal.emplace_back (since (b));
+        }
+    }
+    report ("track_t::add_point", us, total * 1e-3);
+    report ("track_t::seal_next (job)", seal, sealing * 1e-3);
+    if (track.size () == points.size ())
+        return true;
+    std::fprintf (stderr, "%zu points in the track, not %zu\n", track.size (), points.size ());
+    return false;
+}
+
+/// Same for the push_back of the former store
+void
+time_vector (std::vector<glm::vec4> const& points)
+{
+    std::vector<glm::vec4> values;
+    std::vector<float> us (points.size ());
+    double total = 0;
+    for (std::size_t i = 0; i < points.size (); ++i)
+    {
+        auto const a = std::chrono::steady_clock::now ();
+        values.push_back (points[i]);
+        total += us[i] = since (a);
+    }
+    report ("vector<vec4>::push_back", us, total * 1e-3);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::vector<std::size_t> sizes { 1'000'000, 10'000'000 };
+    if (argc > 1)
+    {
+        sizes.clear ();
+        for (int i = 1; i < argc; ++i)
+            sizes.push_back (std::strtoull (argv[i], nullptr, 10));
+    }
+
+    for (auto n: sizes)
+    {
+        std::vector<glm::vec4> points (n);
+        bench::walk w;
+        for (auto& p: points)
+            p = w.step ();
+
+        std::printf ("== %zu points\n", n);
+        if (!bench::time_track (points))
+            return 1;
+        bench::time_vector (points);
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
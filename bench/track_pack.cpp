@@ -0,0 +1,206 @@
+/**
+ * @file track_pack.cpp
+ * @brief Memory of the packed track blocks, and the cost of packing and reading them
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: track_pack [points]
+ *
+ * A track of the synthetic walk, 5M points by default, is appended as the plugin does, then each
+ * full block is sealed into a #track_pack, as the packing job of the plugin does. Its memory is
+ * compared with the 16 bytes a point of the glm::vec4 vector the track used to be, and with the
+ * blocks left unpacked. Then each block is packed and decoded again on its own, checked to come
+ * back the same, and the track is read through the decoding cache: a pass over all the blocks
+ * and the iterators. The time searches, which decode the times of a single group instead, are
+ * checked against a search of all the times. Last, two windows are searched each frame, on their
+ * own range views and on a single one.
+ */
+
+#include "track.hpp"
+#include "walk.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock clock;
+
+double
+since (clock::time_point a)
+{
+    return std::chrono::duration<double> (clock::now () - a).count ();
+}
+
+/// Of the results only summed up, so that their passes are not optimized out
+volatile double sink;
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::size_t const n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 5'000'000;
+
+    track_t track;
+    track.merge_distance (0);
+    bench::walk w;
+    std::vector<glm::vec4> points (n);
+    for (auto& p: points)
+        p = w.step ();
+    auto a = bench::clock::now ();
+    for (auto const& p: points)
+        track.add_point (p);
+    double const append = bench::since (a);
+    a = bench::clock::now ();
+    while (track.seal_next ())
+        ;
+    double const seal = bench::since (a);
+
+    bool updated;
+    auto const all = track.time_range (points[0].w, track.last_time (), updated);
+    auto const& s = *all.first.store ();
+    std::size_t const sealed = s.size () >> track_block::bits;
+    std::printf ("== %zu points, %zu blocks of %zu, appended at %.0f ns a point, sealed at"
+                 " %.1f us a block\n", s.size (), s.block_count (), track_block::size,
+                 append / double (n) * 1e9, seal / double (sealed) * 1e6);
+    std::printf ("   store        %7.1f MB  %5.2f B/pt\n", double (s.memory ()) / 1e6,
+                 double (s.memory ()) / double (n));
+    std::printf ("   vector<vec4> %7.1f MB  %5.2f B/pt\n",
+                 double (n * sizeof (glm::vec4)) / 1e6, double (sizeof (glm::vec4)));
+    std::printf ("   unpacked     %7.1f MB  %5.2f B/pt\n",
+                 double (s.block_count () * sizeof (track_block)) / 1e6,
+                 double (s.block_count () * sizeof (track_block)) / double (n));
+    if (!sealed)
+        return 0;
+
+    // Each sealed block on its own, from a copy decoded out of the cache
+    auto block = std::make_unique<track_block> (), back = std::make_unique<track_block> ();
+    double encode = 0, decode = 0;
+    std::size_t bytes = 0, wrong = 0;
+    for (std::size_t b = 0; b < sealed; ++b)
+    {
+        *block = s.block (b);
+        a = bench::clock::now ();
+        track_pack const pack (*block);
+        encode += bench::since (a);
+        bytes += pack.bytes.size ();
+        a = bench::clock::now ();
+        pack.decode (*back);
+        decode += bench::since (a);
+        wrong += std::memcmp (block->x, back->x, sizeof (block->x))
+              || std::memcmp (block->y, back->y, sizeof (block->y))
+              || std::memcmp (block->z, back->z, sizeof (block->z))
+              || std::memcmp (block->t, back->t, sizeof (block->t));
+    }
+    std::printf ("   pack         %5.2f B/pt of varints, encode %5.1f us, decode %5.1f us "
+                 "a block\n", double (bytes) / double (sealed * track_block::size),
+                 encode / double (sealed) * 1e6, decode / double (sealed) * 1e6);
+    if (wrong)
+        std::fprintf (stderr, "%zu blocks not decoded the same as packed\n", wrong);
+
+    // Through the cache, which misses on each block of a pass
+    double sum = 0;
+    a = bench::clock::now ();
+    for (std::size_t b = 0; b < sealed; ++b)
+        sum += s.block (b).x[b & track_block::mask];
+    double const pass = bench::since (a);
+    std::printf ("   decode pass  %5.1f Mpts/s, %5.1f us a block\n",
+                 double (sealed * track_block::size) / pass / 1e6, pass / double (sealed) * 1e6);
+
+    a = bench::clock::now ();
+    for (auto it = all.first; it != all.second; ++it)
+        sum += it->x;
+    std::printf ("   iterate      %5.1f ns a point\n", bench::since (a) / double (n) * 1e9);
+
+    // Ranges of a tenth of the track spread over it, both ends new on each call
+    float const t0 = points[0].w, t1 = track.last_time (), span = (t1 - t0) / 10;
+    std::vector<std::pair<std::size_t, std::size_t>> got (10000);
+    a = bench::clock::now ();
+    for (int k = 0; k < 10000; ++k)
+    {
+        float const f = t0 + (t1 - t0 - span) * float (k % 1000) / 1000 + float (k) * 1e-6f;
+        auto r = track.time_range (f, f + span, updated);
+        got[k] = { r.first.position (), r.second.position () };
+    }
+    std::printf ("   time_range   %5.2f us a call\n", bench::since (a) / 10000 * 1e6);
+
+    // Against a search of all the times
+    std::size_t misplaced = 0;
+    std::vector<std::int64_t> ticks (n);
+    for (std::size_t i = 0; i < n; ++i)
+        ticks[i] = track_block::ticks (points[i].w);
+    for (int k = 0; k < 10000; ++k)
+    {
+        float const f = t0 + (t1 - t0 - span) * float (k % 1000) / 1000 + float (k) * 1e-6f;
+        auto const lo = std::lower_bound (ticks.begin (), ticks.end (), track_block::ticks (f));
+        auto const hi = std::upper_bound (ticks.begin (), ticks.end (),
+                                          track_block::ticks (f + span));
+        if (got[k] != std::make_pair (std::size_t (lo - ticks.begin ()),
+                                      std::size_t (hi - ticks.begin ())))
+            ++misplaced;
+    }
+    if (misplaced)
+        std::fprintf (stderr, "%zu time ranges not found where they are\n", misplaced);
+
+    // A window with its end moving, as by the slider, over the one as long just before it,
+    // each on its own view, against both sharing the default one as they would without views
+    auto const view = track.make_view ();
+    double frame[2];
+    std::size_t mixed = 0;
+    for (int shared = 0; shared < 2; ++shared)
+    {
+        a = bench::clock::now ();
+        for (int k = 0; k < 10000; ++k)
+        {
+            float const f = t0 + span, e = f + span * float (1 + k % 1000) / 1000;
+            auto r = track.time_range (f, e, updated);
+            auto p = track.time_range (shared ? track_t::default_view : view,
+                                       std::max (t0, 2 * f - e), f, updated);
+            if (!shared)
+                got[k] = { r.second.position (), p.first.position () };
+            else if (got[k] != std::make_pair (r.second.position (), p.first.position ()))
+                ++mixed;
+        }
+        frame[shared] = bench::since (a) / 10000 * 1e6;
+    }
+    track.drop_view (view);
+    std::printf ("   2 windows    %5.2f us a frame on their own views, %5.2f us on a shared one\n",
+                 frame[0], frame[1]);
+
+    bench::sink = sum;
+    if (mixed)
+        std::fprintf (stderr, "%zu windows not the same on their own views\n", mixed);
+    return wrong || misplaced || mixed;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,207 @@
+/**
+ * @file track_simd.cpp
+ * @brief The SIMD kernels of the track and the passes over it, at each instruction set
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Usage: track_simd [points]
+ *
+ * The kernels of src/track_simd.hpp run on the columns of the synthetic walk, a million points by
+ * default, then the passes of track_t which are made of them. Each is run at every level up to
+ * the one of the host, through simd::active(), and the results of the vector ones are checked
+ * against the scalar ones. The times are the median of a few runs.
+ */
+
+#include "track.hpp"
+#include "walk.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+/// Median time of @p f in milliseconds
+template<class F>
+double
+time_ms (F&& f, int runs = 15)
+{
+    std::vector<double> t (runs);
+    for (auto& v: t)
+    {
+        auto const a = std::chrono::steady_clock::now ();
+        f ();
+        v = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - a)
+            .count ();
+    }
+    std::nth_element (t.begin (), t.begin () + runs / 2, t.end ());
+    return t[runs / 2];
+}
+
+char const*
+level_name (simd::level l)
+{
+    return l == simd::level::avx2 ? "avx2" : l == simd::level::sse2 ? "sse2" : "scalar";
+}
+
+bool failed = false;
+
+/// Of the results only summed up, so that their passes are not optimized out
+volatile double sink;
+
+void
+check (bool ok, char const* what, simd::level l)
+{
+    if (!ok)
+        std::fprintf (stderr, "%s differs from the scalar one at %s\n", what, level_name (l));
+    failed |= !ok;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+int
+main (int argc, char** argv)
+{
+    std::size_t const n = argc > 1 ? std::strtoull (argv[1], nullptr, 10) : 1'000'000;
+
+    std::vector<float> x (n), y (n), z (n), xy (2 * n), screen (2 * n);
+    std::vector<std::int64_t> t (n);
+    track_t track;
+    track.merge_distance (0);
+    bench::walk w;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto const p = w.step ();
+        x[i] = p.x, y[i] = p.y, z[i] = p.z, t[i] = track_block::ticks (p.w);
+        xy[2*i] = p.x, xy[2*i+1] = p.y;
+        track.add_point (p);
+    }
+    while (track.seal_next ())
+        ;
+    float const t0 = float (track_block::days (t[0])), t1 = track.last_time ();
+
+    auto const host = simd::detected ();
+    std::printf ("== %zu points, host level %s\n", n, bench::level_name (host));
+    std::printf ("   %-7s %9s %9s %9s %12s %9s %9s %9s %9s\n", "level", "minmax", "speeds",
+                 "affine", "count_below", "c_speeds", "c_length", "t_range", "bbox");
+
+    // Of the scalar level, to check the others against
+    float minmax0[2] = {}, speeds0[2] = {};
+    std::vector<float> screen0;
+    std::size_t count0 = 0;
+
+    std::vector<float> out (n);
+    for (auto l: { simd::level::scalar, simd::level::sse2, simd::level::avx2 })
+    {
+        if (l > host)
+            break;
+        simd::active () = l;
+
+        float lo = 0, hi = 0;
+        double const minmax = bench::time_ms ([&] {
+            lo = std::numeric_limits<float>::max (), hi = -lo;
+            simd::minmax (x.data (), n, lo, hi);
+        });
+        float slo = 0, shi = 0;
+        std::size_t sn = 0;
+        double const speeds = bench::time_ms ([&] {
+            slo = std::numeric_limits<float>::max (), shi = 0;
+            sn = simd::speeds (x.data (), y.data (), z.data (), t.data (),
+                               track_block::tick_seconds, n, out.data (), slo, shi);
+        });
+        double const affine = bench::time_ms ([&] {
+            simd::affine (xy.data (), n, 1000, -2000, 1e-2f, -1e-2f, 40, 20, screen.data ());
+        });
+
+        // Over a block, as the time searches do, for the bounds spread over it
+        std::size_t count = 0;
+        auto const bn = std::min (n, track_block::size);
+        double const count_below = bench::time_ms ([&] {
+            count = 0;
+            for (std::size_t k = 0; k < 1000; ++k)
+                count += simd::count_below<false> (t.data (), bn, t[k * bn / 1000]);
+        }) / 1000 * 1e6;
+
+        std::vector<float> sp;
+        float clo, chi;
+        bool updated;
+        auto const all = track.time_range (t0, t1, updated);
+        double const c_speeds = bench::time_ms ([&] {
+            track_t::compute_speeds (all.first, all.second, sp, clo, chi);
+        });
+        double len = 0;
+        double const c_length = bench::time_ms ([&] {
+            for (int k = 0; k < 1000; ++k)
+                len += track_t::compute_length (all.first + k, all.second);
+        }) / 1000 * 1e6;
+
+        // A new bound on both ends each call, as dragging the time sliders does
+        std::size_t found = 0;
+        double const t_range = bench::time_ms ([&] {
+            for (int k = 0; k < 1000; ++k)
+            {
+                float const a = t0 + (t1 - t0) * float (k) / 2000;
+                auto r = track.time_range (a, a + (t1 - t0) / 2, updated);
+                found += std::size_t (r.second - r.first);
+            }
+        }) / 1000 * 1e3;
+        float left = 0;
+        auto const d = std::ptrdiff_t (n / 3000);
+        double const bbox = bench::time_ms ([&] {
+            for (std::ptrdiff_t k = 0; k < 1000; ++k)
+                left += track.bounding_box (all.first + k * d, all.second - k * d).first.x;
+        }) / 1000 * 1e3;
+
+        std::printf ("   %-7s %6.3f ms %6.3f ms %6.3f ms %9.1f ns %6.2f ms %6.1f ns %6.2f us "
+                     "%6.2f us\n", bench::level_name (l), minmax, speeds, affine, count_below,
+                     c_speeds, c_length, t_range, bbox);
+        bench::sink = len + double (found) + left;
+
+        if (l == simd::level::scalar)
+        {
+            minmax0[0] = lo, minmax0[1] = hi, speeds0[0] = slo, speeds0[1] = shi;
+            screen0 = screen, count0 = count;
+            continue;
+        }
+        bench::check (minmax0[0] == lo && minmax0[1] == hi, "minmax", l);
+        bench::check (sn == sp.size () && std::abs (speeds0[0] - slo) <= 1e-5f * speeds0[0]
+                      && std::abs (speeds0[1] - shi) <= 1e-5f * speeds0[1], "speeds", l);
+        bench::check (count0 == count, "count_below", l);
+        bool same = true;
+        for (std::size_t i = 0; i < 2 * n && same; ++i)
+            same = std::abs (screen[i] - screen0[i])
+                <= 1e-5f * std::max (1.f, std::abs (screen0[i]));
+        bench::check (same, "affine", l);
+    }
+    return bench::failed;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,75 @@
+/**
+ * @file walk.hpp
+ * @brief Synthetic walk of the player over the map, the same on each run
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Benchmarks
+ *
+ * @details
+ * Steps of 100 to 300 game units on a slowly turning heading, bouncing off the edges of the map,
+ * with a rare teleport as a fast travel would make. The time goes 100 game seconds a step.
+ */
+
+#ifndef BENCH_WALK_HPP
+#define BENCH_WALK_HPP
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace bench {
+
+//--------------------------------------------------------------------------------------------------
+
+struct walk
+{
+    std::mt19937 rng { 1234 };
+    float x = 0, y = 0, heading = 0;
+    double time = .45;              ///< In game days, not to stall on long walks
+
+    /// The next point: XYZ in game units and the time in days
+    glm::vec4 step ()
+    {
+        std::uniform_real_distribution<float> u (0, 1);
+        if (u (rng) < 1e-4f)
+        {
+            x = (u (rng) * 2 - 1) * 150000;
+            y = (u (rng) * 2 - 1) * 100000;
+        }
+        heading += (u (rng) - .5f) * .6f;
+        float const d = 100 + 200 * u (rng);
+        x += d * std::cos (heading), y += d * std::sin (heading);
+        if (std::abs (x) > 150000 || std::abs (y) > 100000)
+        {
+            heading += float (M_PI);
+            x = std::clamp (x, -150000.f, 150000.f), y = std::clamp (y, -100000.f, 100000.f);
+        }
+        time += 100. / 86400;
+        return glm::vec4 (x, y, 1000 + 500 * std::sin (x * 1e-4f), float (time));
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * @file discovery.hpp
+ * @brief Persistent map of the explored area, at multiple resolutions
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ */
+
+#ifndef DISCOVERY_HPP
+#define DISCOVERY_HPP
+
+#ifndef GLM_FORCE_CXX14
+#define GLM_FORCE_CXX14
+#endif
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * One bit per cell of a square grid over the map texture, set once the cell was seen.
+ *
+ * The cells are kept in tiles of 64 by 64, allocated only when one of their cells is set, hence
+ * unexplored parts cost nothing. Each next level of the pyramid halves the resolution, a cell of
+ * it set as soon as any of the four cells below is. So that a view can take the level which is
+ * about a pixel per cell, whatever the zoom.
+ */
+
+class discovery_map
+{
+public:
+
+    static constexpr unsigned bits = 12;                    ///< Cells along a side, as power of 2
+    static constexpr unsigned tile_bits = 6;                ///< Same, of a tile
+    static constexpr unsigned levels = bits - tile_bits + 1;    ///< Down to a single tile
+    static constexpr int size = 1 << bits;
+
+    /// One row per 64 bit word, the lowest bit on the left
+    typedef std::array<std::uint64_t, 1 << tile_bits> tile;
+
+    discovery_map ()
+    {
+        for (unsigned k = 0; k < levels; ++k)
+            tiles[k].resize (std::size_t (tiles_per_side (k)) * tiles_per_side (k));
+    }
+
+    void clear ()
+    {
+        for (auto& l: tiles)
+            for (auto& t: l)
+                t.reset ();
+        ++revision_;
+    }
+
+    /// Takes the cells of another map, as if all of them changed
+    void assign (discovery_map&& other)
+    {
+        for (unsigned k = 0; k < levels; ++k)
+            tiles[k] = std::move (other.tiles[k]);
+        revision_ = std::max (revision_, other.revision_) + 1;
+    }
+
+    /// Changes on every newly set cell
+    std::uint64_t revision () const { return revision_; }
+
+    static int resolution (unsigned level) { return size >> level; }
+
+    bool test (unsigned level, int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= resolution (level) || y >= resolution (level))
+            return false;
+        auto const& t = tiles[level][tile_index (level, x, y)];
+        return t && ((*t)[y & tile_mask] >> (x & tile_mask) & 1);
+    }
+
+    /// Sets the cells whose centers are closer than @p r to the segment [a, b], all in cells of
+    /// the finest level. A disc is a segment of no length.
+    void stamp (glm::vec2 const& a, glm::vec2 const& b, float r)
+    {
+        auto const d = b - a;
+        float const l = glm::length (d);
+        glm::vec2 const u = l > 0 ? d / l : glm::vec2 (0);
+
+        // Where the linear function c + k px is within [lo, hi], narrowing [x0, x1]
+        auto clip = [] (float c, float k, float lo, float hi, float& x0, float& x1)
+        {
+            if (k == 0)
+            {
+                if (c < lo || c > hi)
+                    x0 = std::numeric_limits<float>::max ();
+                return;
+            }
+            float p = (lo - c) / k, q = (hi - c) / k;
+            x0 = std::max (x0, std::min (p, q));
+            x1 = std::min (x1, std::max (p, q));
+        };
+
+        int const y0 = std::max (0, int (std::floor (std::min (a.y, b.y) - r)));
+        int const y1 = std::min (size - 1, int (std::ceil (std::max (a.y, b.y) + r)));
+        for (int y = y0; y <= y1; ++y)
+        {
+            // The capsule is convex, hence the discs and the band make a single span
+            float const py = y + .5f;
+            float x0 = std::numeric_limits<float>::max (), x1 = -x0;
+            for (auto const& c: { a, b })
+                if (float w2 = r * r - (py - c.y) * (py - c.y); w2 > 0)
+                {
+                    float w = std::sqrt (w2);
+                    x0 = std::min (x0, c.x - w);
+                    x1 = std::max (x1, c.x + w);
+                }
+            if (l > 0)
+            {
+                float b0 = -std::numeric_limits<float>::max (), b1 = -b0;
+                clip (-a.x * u.y - (py - a.y) * u.x, u.y, -r, r, b0, b1);
+                clip (-a.x * u.x + (py - a.y) * u.y, u.x, 0, l, b0, b1);
+                if (b0 <= b1)
+                    x0 = std::min (x0, b0), x1 = std::max (x1, b1);
+            }
+            if (x0 <= x1)
+                fill (y, std::max (0, int (std::ceil (x0 - .5f))),
+                         std::min (size - 1, int (std::floor (x1 - .5f))));
+        }
+    }
+
+    /// The allocated tiles of the finest level only, the coarser ones are made on load
+    template<class OStream>
+    void save_binary (OStream& os) const
+    {
+        std::uint32_t n = 0;
+        for (auto const& t: tiles[0])
+            n += bool (t);
+        write_u32 (os, file_tag);
+        write_u32 (os, file_version);
+        write_u32 (os, bits);
+        write_u32 (os, n);
+        for (std::size_t i = 0; i < tiles[0].size (); ++i)
+            if (auto const& t = tiles[0][i])
+            {
+                write_u32 (os, std::uint32_t (i));
+                os.write (reinterpret_cast<const char*> (t->data ()), sizeof (tile));
+            }
+    }
+
+    /// Counterpart of #save_binary(), returns false for a file of another layout
+    template<class IStream>
+    bool load_binary (IStream& is)
+    {
+        clear ();
+        if (read_u32 (is) != file_tag || read_u32 (is) != file_version || read_u32 (is) != bits)
+            return false;
+        for (auto n = read_u32 (is); n && is; --n)
+        {
+            auto i = read_u32 (is);
+            tile t;
+            is.read (reinterpret_cast<char*> (t.data ()), sizeof (tile));
+            if (!is || i >= tiles[0].size ())
+                return false;
+            tiles[0][i] = std::make_unique<tile> (t);
+        }
+        for (unsigned k = 1; k < levels; ++k)
+            reduce (k);
+        return bool (is);
+    }
+
+private:
+
+    static constexpr int tile_mask = (1 << tile_bits) - 1;
+    static constexpr std::uint32_t file_tag = 0x31574f46;   ///< "FOW1"
+    static constexpr std::uint32_t file_version = 1;
+
+    static int tiles_per_side (unsigned level)
+    {
+        return std::max (1, resolution (level) >> tile_bits);
+    }
+
+    static std::size_t tile_index (unsigned level, int x, int y)
+    {
+        return std::size_t (x >> tile_bits) + std::size_t (y >> tile_bits) * tiles_per_side (level);
+    }
+
+    /// Sets [x0, x1] on the row @p y of the finest level, and on the rows above it as long as
+    /// there is anything new
+    void fill (int y, int x0, int x1)
+    {
+        for (unsigned k = 0; k < levels && x0 <= x1; ++k)
+            if (!set_bits (k, y >> k, x0 >> k, x1 >> k))
+                break;
+    }
+
+    /// Returns whether any of the bits was not set before
+    bool set_bits (unsigned level, int y, int x0, int x1)
+    {
+        bool changed = false;
+        for (int x = x0; x <= x1; x = (x | tile_mask) + 1)
+        {
+            auto& t = tiles[level][tile_index (level, x, y)];
+            if (!t)
+                t = std::make_unique<tile> (tile {});
+            int const e = std::min (x1, x | tile_mask);
+            auto const hi = (e & tile_mask) == tile_mask ? ~std::uint64_t (0)
+                          : (std::uint64_t (1) << ((e & tile_mask) + 1)) - 1;
+            auto const mask = hi & (~std::uint64_t (0) << (x & tile_mask));
+            auto& row = (*t)[y & tile_mask];
+            changed |= (row & mask) != mask;
+            row |= mask;
+        }
+        revision_ += changed;
+        return changed;
+    }
+
+    /// Makes a level out of the one below, each tile of which is a quarter of a tile
+    void reduce (unsigned level)
+    {
+        int const n = tiles_per_side (level - 1);
+        for (int ty = 0; ty < n; ++ty)
+            for (int tx = 0; tx < n; ++tx)
+            {
+                auto const& t = tiles[level - 1][tx + ty * std::size_t (n)];
+                if (!t)
+                    continue;
+                auto& p = tiles[level][tile_index (level, tx << (tile_bits - 1),
+                                                               ty << (tile_bits - 1))];
+                if (!p)
+                    p = std::make_unique<tile> (tile {});
+                int const half = 1 << (tile_bits - 1);  // The quarter of it, in cells
+                for (int y = 0; y <= tile_mask; y += 2)
+                {
+                    // Pairs of bits into one, every second one moved together
+                    auto w = (*t)[y] | (*t)[y + 1];
+                    w = (w | w >> 1) & 0x5555555555555555;
+                    w = (w | w >> 1) & 0x3333333333333333;
+                    w = (w | w >> 2) & 0x0f0f0f0f0f0f0f0f;
+                    w = (w | w >> 4) & 0x00ff00ff00ff00ff;
+                    w = (w | w >> 8) & 0x0000ffff0000ffff;
+                    w = (w | w >> 16) & 0x00000000ffffffff;
+                    (*p)[(ty & 1) * half + (y >> 1)] |= w << (tx & 1) * half;
+                }
+            }
+        ++revision_;
+    }
+
+    template<class OStream>
+    static void write_u32 (OStream& os, std::uint32_t u)
+    {
+        os.write (reinterpret_cast<const char*> (&u), sizeof (u));
+    }
+
+    template<class IStream>
+    static std::uint32_t read_u32 (IStream& is)
+    {
+        std::uint32_t u = 0;
+        is.read (reinterpret_cast<char*> (&u), sizeof (u));
+        return is ? u : 0;
+    }
+
+    std::vector<std::unique_ptr<tile>> tiles[levels];
+    std::uint64_t revision_ = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
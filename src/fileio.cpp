@@ -28,6 +28,7 @@
 #include "maptrack.hpp"
 #include <gsl/gsl_util>
 #include <fstream>
+#include <memory>
 
 //--------------------------------------------------------------------------------------------------
 
@@ -161,7 +162,11 @@ load_icons (std::filesystem::path const& filename)
             icons.push_back (i);
         }
 
-        maptrack.icons = std::move (icons);
+        // Through the same slots, any handle to the former icons stays invalid
+        maptrack.icons.clear ();
+        maptrack.icons.reserve (icons.size ());
+        for (auto& i: icons)
+            maptrack.icons.insert (std::move (i));
     }
     catch (std::exception const& ex)
     {
@@ -256,16 +261,23 @@ save_settings ()
             }},
             { "Fog of War", {
                 { "enabled", maptrack.fow.enabled },
+                { "persistent", maptrack.fow.persistent },
                 { "resolution", maptrack.fow.resolution },
                 { "discover", maptrack.fow.discover },
                 { "default alpha", maptrack.fow.default_alpha },
                 { "tracked alpha", maptrack.fow.tracked_alpha },
             }},
             { "update period", maptrack.update_period },
+            { "job budget", maptrack.job_budget },
+            { "worker threads", maptrack.worker_threads },
             { "min distance", maptrack.min_distance },
             { "track enabled", maptrack.track_enabled },
             { "track width", maptrack.track_width },
             { "track color", hex_string (maptrack.track_color) },
+            { "Previous range", {
+                { "enabled", maptrack.compare.enabled },
+                { "color", hex_string (maptrack.compare.color) }
+            }},
             { "Cursor info", {
                 { "enabled", maptrack.cursor_info.enabled },
                 { "deformation", maptrack.cursor_info.deformation },
@@ -351,12 +363,23 @@ load_settings ()
         }
 
         maptrack.update_period = json.value ("update period", 5.f);
+        maptrack.job_budget = json.value ("job budget", 1.f);
+        maptrack.worker_threads = json.value ("worker threads", 4);
         maptrack.min_distance = json.value ("min distance", 10.f); //1:205 map scale by 5x zoom
         maptrack.track_enabled = json.value ("track enabled", true);
         maptrack.track_width = json.value ("track width", 3.f);
         maptrack.track_color = std::stoul (json.value ("track color", "0xFF400000"), nullptr, 0);
         maptrack.track.merge_distance (maptrack.min_distance);
 
+        maptrack.compare.enabled = false;
+        maptrack.compare.color = 0xFF004080;
+        if (json.contains ("Previous range"))
+        {
+            auto const& j = json.at ("Previous range");
+            maptrack.compare.enabled = j.value ("enabled", maptrack.compare.enabled);
+            maptrack.compare.color = std::stoul (j.value ("color", "0xFF004080"), nullptr, 0);
+        }
+
         maptrack.player.enabled = true;
         maptrack.player.color = 0xFF400000;
         maptrack.player.size = 6.f;
@@ -369,6 +392,7 @@ load_settings ()
         }
 
         maptrack.fow.enabled = true;
+        maptrack.fow.persistent = false;
         maptrack.fow.resolution = 128;
         maptrack.fow.discover   = 4;
         maptrack.fow.player_alpha = 0.f;
@@ -378,6 +402,7 @@ load_settings ()
         {
             auto const& j = json.at ("Fog of War");
             maptrack.fow.enabled = j.value ("enabled", maptrack.fow.enabled);
+            maptrack.fow.persistent = j.value ("persistent", maptrack.fow.persistent);
             maptrack.fow.resolution = j.value ("resolution", maptrack.fow.resolution);
             maptrack.fow.discover = j.value ("discover", maptrack.fow.discover);
             maptrack.fow.default_alpha = j.value ("default alpha", maptrack.fow.default_alpha);
@@ -437,6 +462,15 @@ save_track (std::filesystem::path const& file)
         write_binary (f, min);
         write_binary (f, patch);
         maptrack.track.save_binary (f);
+
+        // The track is saved by now, whatever becomes of its discovered area: without it, the
+        // load makes it again from the points
+        auto fow = std::filesystem::path (file).replace_extension (".fow");
+        std::ofstream fd (fow, std::ios::binary | std::ios::out);
+        if (fd.is_open ())
+            maptrack.discovered.save_binary (fd);
+        else
+            log () << "Unable to open " << fow << " for writting." << std::endl;
     }
     catch (std::exception const& ex)
     {
@@ -459,21 +493,70 @@ read_binary (Stream& is)
 
 //--------------------------------------------------------------------------------------------------
 
+/// After a new track took the place: the jobs over the former one would read past its points,
+/// and the discovered area of the file goes along with it.
+static void
+track_loaded (std::filesystem::path const& file)
+{
+    for (auto job: { "Track speeds", "Fog of War", "Reprojecting Track", "Reprojecting Previous" })
+        maptrack.jobs.cancel (job);
+
+    // Tracks of older versions have it made from their points, taking the gaps in them which are
+    // shorter than a teleport as travelled. The area of the former track is of no use to them, so
+    // it is dropped at once and a job uncovers the new one in parts.
+    std::ifstream fd (std::filesystem::path (file).replace_extension (".fow"),
+            std::ios::binary | std::ios::in);
+    discovery_map loaded;
+    maptrack.jobs.cancel ("Discovered area");
+    if (fd.is_open () && loaded.load_binary (fd))
+        maptrack.discovered.assign (std::move (loaded));
+    else
+    {
+        maptrack.discovered.clear ();
+        maptrack.jobs.submit ("Discovered area",
+                [k = std::size_t (0),
+                 prev = glm::vec2 { std::numeric_limits<float>::quiet_NaN () }] () mutable
+        {
+            constexpr std::size_t job_points = 1 << 12;
+            auto const n = std::min (maptrack.track.size (), k + job_points);
+            for (auto it = maptrack.track.begin () + k; k < n; ++k, ++it)
+            {
+                glm::vec2 p = *it;
+                maptrack.discover (prev, p), prev = p;
+            }
+            return k < maptrack.track.size ();
+        });
+    }
+}
+
+/// Opens a track file past its header, the stream is closed on failure
+static bool
+open_track (std::filesystem::path const& file, std::ifstream& f)
+{
+    f.open (file, std::ios::binary | std::ios::in);
+    if (!f.is_open ())
+    {
+        log () << "Unable to open " << file << " for reading." << std::endl;
+        return false;
+    }
+    read_binary<std::int32_t> (f);
+    read_binary<std::int32_t> (f);
+    read_binary<std::int32_t> (f);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool
 load_track (std::filesystem::path const& file)
 {
     try
     {
-        std::ifstream f (file, std::ios::binary | std::ios::in);
-        if (!f.is_open ())
-        {
-            log () << "Unable to open " << file << " for reading." << std::endl;
+        std::ifstream f;
+        if (!open_track (file, f))
             return false;
-        }
-        read_binary<std::int32_t> (f);
-        read_binary<std::int32_t> (f);
-        read_binary<std::int32_t> (f);
         maptrack.track.load_binary (f);
+        track_loaded (file);
     }
     catch (std::exception const& ex)
     {
@@ -485,3 +568,34 @@ load_track (std::filesystem::path const& file)
 
 //--------------------------------------------------------------------------------------------------
 
+bool
+load_track_in_steps (std::filesystem::path const& file)
+{
+    auto f = std::make_shared<std::ifstream> ();
+    if (!open_track (file, *f))
+        return false;
+
+    // Read and decoded apart, while the former track is still drawn and recorded to. The blocks
+    // are packed later by the timer job, as for the recording.
+    auto loaded = std::make_shared<track_t> ();
+    auto state = std::make_shared<track_t::load_state> ();
+    maptrack.jobs.submit ("Track loading", [f, file, loaded, state]
+    {
+        try
+        {
+            if (loaded->load_step (*f, *state))
+                return true;
+            maptrack.track.assign (std::move (*loaded));
+            track_loaded (file);
+        }
+        catch (std::exception const& ex)
+        {
+            log () << "Unable to load track file: " << ex.what () << std::endl;
+        }
+        return false;
+    });
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
@@ -0,0 +1,258 @@
+/**
+ * @file icon_grid.hpp
+ * @brief Spatial index of the map icons
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ */
+
+#ifndef ICON_GRID_HPP
+#define ICON_GRID_HPP
+
+#ifndef GLM_FORCE_CXX14
+#define GLM_FORCE_CXX14
+#endif
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Uniform grid over the map UV square, each cell listing the icons centered in it.
+ *
+ * The icons are known by an id which stays the same while they live, as the slot of their handle
+ * in the icon list. The rectangles are kept in the cells too, so the queries do not have to look
+ * the icons up, and in the order of the ids. A query takes the cells as far around as #reach.
+ * The few icons larger than that are kept apart in a list of their own, so that one of them does
+ * not widen all the queries. Anything out of the square goes to the cells on its border.
+ *
+ * A query over most of the square scans instead all the icons by id, which also gives the ids
+ * in order.
+ *
+ * On top of the grid, a pyramid of clusters: the icons of each square of 2^level cells, as their
+ * count, mean center and the one of the lowest id. For drawing the far zooms, where the icons get
+ * too small to tell apart.
+ */
+
+class icon_grid
+{
+public:
+
+    static constexpr int size = 64;     ///< Cells along a side, about the default icon size
+    static constexpr unsigned levels = 7;   ///< Of clusters, from one per cell to one in total
+
+    static constexpr std::uint32_t none = ~std::uint32_t (0);
+
+    struct entry
+    {
+        glm::vec2 tl, br;
+        std::uint32_t id;
+    };
+
+    struct cluster
+    {
+        std::uint32_t count, first;
+        glm::dvec2 sum;                 ///< Of the centers
+        glm::vec2 center () const { return glm::vec2 (sum / double (count)); }
+    };
+
+    /// Half size past which an icon is kept out of the cells, two of them
+    static constexpr float reach = 2.f / size;
+
+    icon_grid () : cells (size * size)
+    {
+        for (unsigned k = 0; k < levels; ++k)
+            clusters[k].resize ((size >> k) * (size >> k));
+        clear ();
+    }
+
+    void clear ()
+    {
+        for (auto& c: cells)
+            c.clear ();
+        for (auto& l: clusters)
+            std::fill (l.begin (), l.end (), cluster { 0, 0, glm::dvec2 (0) });
+        large.clear ();
+        all.clear ();
+    }
+
+    void insert (std::uint32_t id, glm::vec2 const& tl, glm::vec2 const& br)
+    {
+        auto const p = .5f * (tl + br);
+        auto& v = list (tl, br);
+        v.insert (std::upper_bound (v.begin (), v.end (), id, by_id {}), entry { tl, br, id });
+        if (id >= all.size ())
+            all.resize (id + 1, entry { glm::vec2 (0), glm::vec2 (0), none });
+        all[id] = entry { tl, br, id };
+        for (unsigned k = 0; k < levels; ++k)
+        {
+            auto& c = cluster_at (k, cell (p));
+            c.first = c.count++ ? std::min (c.first, id) : id;
+            c.sum += glm::dvec2 (p);
+        }
+    }
+
+    /// As for a moved or rescaled icon, by its former rectangle
+    void move (std::uint32_t id, glm::vec2 const& old_tl, glm::vec2 const& old_br,
+               glm::vec2 const& tl, glm::vec2 const& br)
+    {
+        remove (id, old_tl, old_br);
+        insert (id, tl, br);
+    }
+
+    /// By the rectangle it was last inserted with
+    void remove (std::uint32_t id, glm::vec2 const& tl, glm::vec2 const& br)
+    {
+        auto const p = .5f * (tl + br);
+        auto& v = list (tl, br);
+        if (auto it = std::lower_bound (v.begin (), v.end (), id, by_id {});
+                it != v.end () && it->id == id)
+            v.erase (it);
+        all[id].id = none;
+
+        // If it was the one of the lowest id, the next is looked up through the cells of the
+        // cluster
+        for (unsigned k = 0; k < levels; ++k)
+        {
+            auto& c = cluster_at (k, cell (p));
+            c.sum -= glm::dvec2 (p);
+            if (--c.count && c.first == id)
+            {
+                c.first = none;
+                auto const o = (cell (p) >> int (k)) << int (k);
+                for (int y = o.y; y < o.y + (1 << k); ++y)
+                    for (int x = o.x; x < o.x + (1 << k); ++x)
+                        if (!cells[x + y * size].empty ())
+                            c.first = std::min (c.first, cells[x + y * size].front ().id);
+                for (auto const& e: large)
+                    if (cell (.5f * (e.tl + e.br)) >> int (k) == o >> int (k))
+                        c.first = std::min (c.first, e.id);
+            }
+        }
+    }
+
+    /// Each icon overlapping the box. Returns true when they came in the order of their ids, as
+    /// by the scan of all the icons, for a box over most of the square.
+    template<class F>
+    bool query (glm::vec2 const& tl, glm::vec2 const& br, F&& f) const
+    {
+        auto overlaps = [&tl, &br] (entry const& e) {
+            return e.tl.x < br.x && e.br.x > tl.x && e.tl.y < br.y && e.br.y > tl.y;
+        };
+        auto const lo = cell (tl - reach), hi = cell (br + reach);
+        if (2 * (hi.x - lo.x + 1) * (hi.y - lo.y + 1) > size * size)
+        {
+            for (auto const& e: all)
+                if (e.id != none && overlaps (e))
+                    f (e.id);
+            return true;
+        }
+        for (int y = lo.y; y <= hi.y; ++y)
+            for (int x = lo.x; x <= hi.x; ++x)
+                for (auto const& e: cells[x + y * size])
+                    if (overlaps (e))
+                        f (e.id);
+        for (auto const& e: large)
+            if (overlaps (e))
+                f (e.id);
+        return false;
+    }
+
+    /// The lowest id of the icons containing the point, borders included, else #none. Each
+    /// list is in id order, hence looked at only up to the first one over the point.
+    std::uint32_t lowest (glm::vec2 const& p) const
+    {
+        auto hit = none;
+        auto first = [&p, &hit] (std::vector<entry> const& v)
+        {
+            for (auto const& e: v)
+                if (e.id >= hit)
+                    return;
+                else if (e.tl.x <= p.x && e.tl.y <= p.y && e.br.x >= p.x && e.br.y >= p.y)
+                {
+                    hit = e.id;
+                    return;
+                }
+        };
+        auto const lo = cell (p - reach), hi = cell (p + reach);
+        for (int y = lo.y; y <= hi.y; ++y)
+            for (int x = lo.x; x <= hi.x; ++x)
+                first (cells[x + y * size]);
+        first (large);
+        return hit;
+    }
+
+    /// Each non-empty cluster of a level over the box, by the squares it is in
+    template<class F>
+    void query_clusters (unsigned level, glm::vec2 const& tl, glm::vec2 const& br, F&& f) const
+    {
+        auto const lo = cell (tl) >> int (level), hi = cell (br) >> int (level);
+        int const n = size >> level;
+        for (int y = lo.y; y <= hi.y; ++y)
+            for (int x = lo.x; x <= hi.x; ++x)
+                if (auto const& c = clusters[level][x + y * n]; c.count)
+                    f (c);
+    }
+
+private:
+
+    static glm::ivec2 cell (glm::vec2 const& p)
+    {
+        return glm::clamp (glm::ivec2 (glm::floor (p * float (size))), 0, size - 1);
+    }
+
+    /// For the searches of the lists by id
+    struct by_id
+    {
+        bool operator () (std::uint32_t id, entry const& e) const { return id < e.id; }
+        bool operator () (entry const& e, std::uint32_t id) const { return e.id < id; }
+    };
+
+    /// Where an icon of the rectangle is kept
+    std::vector<entry>& list (glm::vec2 const& tl, glm::vec2 const& br)
+    {
+        auto const half = (br - tl) * .5f;
+        if (half.x > reach || half.y > reach)
+            return large;
+        auto const c = cell (tl + half);
+        return cells[c.x + c.y * size];
+    }
+
+    cluster& cluster_at (unsigned level, glm::ivec2 const& c)
+    {
+        return clusters[level][(c.x >> level) + (c.y >> level) * (size >> level)];
+    }
+
+    std::vector<std::vector<entry>> cells;
+    std::vector<entry> large;           ///< Icons past #reach, in id order
+    std::vector<entry> all;             ///< By id, #none for the ids not in use
+    std::vector<cluster> clusters[levels];
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,133 @@
+/**
+ * @file jobs.hpp
+ * @brief Long computations run a bit on every frame
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ */
+
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Cooperative scheduler of the jobs too long for a single frame.
+ *
+ * A job is a function doing a bounded step of the work on each call, returning whether there is
+ * more to do. Its state lives in the function itself, and its results are published by its last
+ * step, so until then the former ones are still there to draw. On each frame the jobs take turns
+ * for steps until the time budget is spent. All of it runs on the render thread.
+ */
+
+class job_scheduler
+{
+public:
+
+    typedef std::function<bool ()> step_function;
+
+    /// Replaces the job of the same name, if any, which is dropped as far as it got
+    void submit (std::string const& name, step_function step)
+    {
+        auto it = find (name);
+        if (it != jobs.end ())
+            it->second = std::move (step);
+        else jobs.emplace_back (name, std::move (step));
+    }
+
+    void cancel (std::string const& name)
+    {
+        auto it = find (name);
+        if (it != jobs.end ())
+            jobs.erase (it);
+    }
+
+    bool pending (std::string const& name) const
+    {
+        return std::any_of (jobs.cbegin (), jobs.cend (),
+                [&name] (job const& j) { return j.first == name; });
+    }
+
+    bool empty () const { return jobs.empty (); }
+
+    /// Names of the jobs yet to finish
+    std::vector<std::string> names () const
+    {
+        std::vector<std::string> v;
+        for (auto const& j: jobs)
+            v.push_back (j.first);
+        return v;
+    }
+
+    /// Steps through the jobs in turn for up to @p budget seconds, at least one step though, so
+    /// that any budget makes progress. A step may submit or cancel jobs.
+    void run (double budget)
+    {
+        using clock = std::chrono::steady_clock;
+        auto const end = clock::now () + std::chrono::duration_cast<clock::duration> (
+                std::chrono::duration<double> (budget));
+        do
+        {
+            if (jobs.empty ())
+                break;
+
+            // Out of the list while it runs, so that it may replace or cancel itself
+            next %= jobs.size ();
+            auto const name = jobs[next].first;
+            auto step = std::move (jobs[next].second);
+            jobs[next].second = nullptr;
+            bool const more = step ();
+            auto it = find (name);
+            if (it == jobs.end () || it->second)
+                continue;
+            if (more)
+                it->second = std::move (step), ++next;
+            else jobs.erase (it);
+        }
+        while (clock::now () < end);
+    }
+
+private:
+
+    typedef std::pair<std::string, step_function> job;
+
+    std::vector<job>::iterator find (std::string const& name)
+    {
+        return std::find_if (jobs.begin (), jobs.end (),
+                [&name] (job const& j) { return j.first == name; });
+    }
+
+    std::vector<job> jobs;
+    std::size_t next = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
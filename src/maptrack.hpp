@@ -29,6 +29,9 @@
 #define MAPTRACK_HPP
 
 #include "track.hpp"
+#include "discovery.hpp"
+#include "slot_map.hpp"
+#include "jobs.hpp"
 
 #include <sse-imgui/sse-imgui.h>
 #include <utils/winutils.hpp>
@@ -103,6 +106,7 @@ bool save_settings ();
 bool load_settings ();
 bool save_track (std::filesystem::path const& file); ///< Modifies maptrack#track
 bool load_track (std::filesystem::path const& file); ///< Modifies maptrack#track
+bool load_track_in_steps (std::filesystem::path const& file); ///< A job to modify maptrack#track
 bool save_icons (std::filesystem::path const& file); ///< Modifies maptrack#icons
 bool load_icons (std::filesystem::path const& file); ///< Modifies maptrack#icons
 
@@ -115,7 +119,7 @@ extern std::filesystem::path
 
 bool setup_variables ();
 
-float obtain_game_time ();
+double obtain_game_time ();
 std::array<float, 3> obtain_player_location ();
 std::string obtain_current_worldspace ();
 std::string obtain_current_cell ();
@@ -214,7 +218,7 @@ struct maptrack_t
     }
 
     icon_atlas_t icon_atlas;
-    std::vector<icon_t> icons;
+    slot_map<icon_t> icons;     ///< Unordered, the handles keep to their icons
 
     bool enabled = true;    ///< Is tracking, polling for data is, enabled or not
     int since_dayx = 0;     ///< Show a map track since day X, can't be less than zero actually.
@@ -227,6 +231,11 @@ struct maptrack_t
     float track_width;
     std::uint32_t track_color;
 
+    struct {
+        bool enabled;
+        std::uint32_t color;
+    } compare;                  ///< The range as long just before the track one, drawn under it
+
     struct {
         bool enabled;
         float size;
@@ -235,6 +244,7 @@ struct maptrack_t
 
     struct {
         bool enabled;
+        bool persistent;        ///< Over all the discovered area, instead of the track range
         int resolution;
         int discover;
         float player_alpha, default_alpha, tracked_alpha;
@@ -249,6 +259,39 @@ struct maptrack_t
 
     /// Heavy scenario: 60 seconds by 60 minutes by 150 game hours = 540k elements
     track_t track;
+
+    /// Saved along the track, see #discover()
+    discovery_map discovered;
+
+    /// Run at the end of each frame, for up to #job_budget
+    job_scheduler jobs;
+    float job_budget;           ///< In milliseconds per frame
+    int worker_threads;         ///< Most threads of a long loop, the render one included
+
+    /// Any longer way between two updates is a teleport, like fast travel or going through doors
+    inline float teleport_distance () const
+    {
+        constexpr float max_speed = 1'000;  ///< Faster than a sprinting horse, in game units
+        return max_speed * update_period;
+    }
+
+    /// Marks the area around the game position @p p as discovered, as well along the way from
+    /// @p prev unless teleported. The radius is that of the Fog of War.
+    inline void discover (glm::vec2 const& prev, glm::vec2 const& p)
+    {
+        discover (discovered, prev, p);
+    }
+
+    /// Same, on another map
+    inline void discover (discovery_map& map, glm::vec2 const& prev, glm::vec2 const& p) const
+    {
+        constexpr float size = discovery_map::size;
+        float const r = fow.discover * size / fow.resolution;
+        auto to = game_to_map (p) * size;
+        auto from = glm::distance2 (prev, p) < teleport_distance () * teleport_distance ()
+                  ? game_to_map (prev) * size : to;
+        map.stamp (from, to, r);
+    }
 };
 
 extern maptrack_t maptrack;
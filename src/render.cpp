@@ -26,10 +26,13 @@
  */
 
 #include "maptrack.hpp"
+#include "icon_grid.hpp"
+#include "thread_pool.hpp"
 #include <cstring>
 #include <cctype>
 #include <algorithm>
 #include <charconv>
+#include <chrono>
 
 #include <windows.h>
 
@@ -52,15 +55,60 @@ static HWND top_window = nullptr;
 static std::string current_location, current_time;
 static glm::vec4 player_location { std::numeric_limits<float>::quiet_NaN () };
 
-/// Current subrange of #maptrack.track selected for rendering, GUI controlled.
-static struct {
+/// Subrange of #maptrack.track selected for rendering, searched through its own view
+struct track_window {
+    track_t::range_view view;
     track_t::const_iterator first, second;
     bool draw_invalidated, length_invalidated;
+    std::size_t changed;        ///< Lowest point index rewritten since the last #draw_track()
+    std::size_t fog_changed;    ///< Same, since the last #draw_fog()
+};
+
+/// Current one, GUI controlled, and the one as long just before it, to compare with. The latter
+/// gets its view on its first use.
+static track_window track_range = {}, compare_range = {};
+
+/// Frames of #draw_fog() by what became of its cached mesh: drawn as it is, moved with the window
+/// or built anew. Shown in the settings.
+static struct {
+    std::uint64_t reused, moved, rebuilt;
 }
-track_range = {};
+fog_cache = {};
 
-/// Easier than to add a lot of code, its also once per add/delete/load
-static bool icons_invalidated = false;
+/// The map layers which were appended as recorded, against the ones recorded anew, and the time
+/// taken by each, in seconds. Shown in the settings.
+static struct {
+    std::uint64_t frames, spliced, recorded;
+    double splice_time, record_time;
+}
+map_layers = {};
+
+/// Easier than to add a lot of code, its also once per add/delete/load. Set from the start, for
+/// the icons loaded by #setup() to be put in the grid.
+static bool icons_invalidated = true;
+
+/// Threads helping the render one with the long loops, with it up to maptrack#worker_threads as
+/// the game itself keeps most of the cores busy, and none on a single core so the loops run
+/// inline. Made on the first use, from the render thread, unless one was put in place (as the
+/// benchmarks do). Made again when the setting changes, otherwise never destroyed, as its threads
+/// could not be joined while the DLL is unloaded.
+static thread_pool* worker_pool = nullptr;
+static unsigned worker_pool_threads = 0;    ///< The setting it was made for, 0 if put in place
+
+static thread_pool&
+workers ()
+{
+    unsigned const threads = std::max (1, maptrack.worker_threads);
+    if (worker_pool && worker_pool_threads && worker_pool_threads != threads)
+        delete std::exchange (worker_pool, nullptr);
+    if (!worker_pool)
+    {
+        unsigned const cores = std::thread::hardware_concurrency ();
+        worker_pool = new thread_pool (cores > 1 ? std::min (cores, threads) - 1 : 0);
+        worker_pool_threads = threads;
+    }
+    return *worker_pool;
+}
 
 static render_load_files render_load_icons, render_load_tracks;
 
@@ -68,15 +116,24 @@ static render_load_files render_load_icons, render_load_tracks;
 
 /// State based, projection of point in game or UV map coordinates into screen space
 /// Better differentation between the both functionalities would be nice.
+///
+/// Both are a scale on each axis around the view corner, the one from the game having the map
+/// conversion folded in, with the corner in game units. Around the corner the points keep their
+/// precision: the results are within 0.03 pixel of exact even 1000 times zoomed in, where the
+/// two steps apart were within 0.1. The batches of points go through the SIMD kernel.
 
 class map_project
 {
     glm::vec2 wpos, uvtl, mul, imul;
+    glm::vec2 gtl, gmul;                ///< The corner and scale from the game
 public:
     map_project (glm::vec2 const& wpos, glm::vec2 const& wsz,
                  glm::vec2 const& uvtl, glm::vec2 const& uvbr)
         : wpos (wpos), uvtl (uvtl), mul (wsz / (uvbr - uvtl)), imul ((uvbr - uvtl) / wsz)
     {
+        glm::dvec2 const s (maptrack.scale.x, -maptrack.scale.y);
+        gtl = glm::vec2 ((glm::dvec2 (uvtl) - glm::dvec2 (maptrack.offset)) / s);
+        gmul = glm::vec2 (glm::dvec2 (mul) * s);
     }
     inline glm::vec2 operator () (glm::vec4 const& p) const
     {
@@ -88,12 +145,21 @@ public:
     }
     inline glm::vec2 game_to_screen (glm::vec2 const& p) const
     {
-        return map_to_screen (maptrack.game_to_map (p));
+        return wpos + gmul * (p - gtl);
     }
     inline glm::vec2 map_to_screen (glm::vec2 const& p) const
     {
         return wpos + mul * (p - uvtl);
     }
+    /// Of @p n points at once, @p out may be @p p
+    void game_to_screen (glm::vec2 const* p, std::size_t n, glm::vec2* out) const
+    {
+        simd::affine (&p->x, n, gtl.x, gtl.y, gmul.x, gmul.y, wpos.x, wpos.y, &out->x);
+    }
+    void map_to_screen (glm::vec2 const* p, std::size_t n, glm::vec2* out) const
+    {
+        simd::affine (&p->x, n, uvtl.x, uvtl.y, mul.x, mul.y, wpos.x, wpos.y, &out->x);
+    }
     inline glm::vec2 screen_to_map (glm::vec2 const& p) const
     {
         return uvtl + imul * (p - wpos);
@@ -127,17 +193,30 @@ timer_callback (HWND hwnd, UINT message, UINT_PTR idTimer, DWORD dwTime)
     for (auto const& l: curr_loc)
         current_location += " " + std::to_string (int (l));
 
-    format_game_time (current_time, "Day %ri, %md of %lm, %Y [%h:%m]", curr_time);
+    format_game_time (current_time, "Day %ri, %md of %lm, %Y [%h:%m]", float (curr_time));
+
+    // Where the discovered area was extended from, a gap in it ends the way
+    static glm::vec2 discovered_from { std::numeric_limits<float>::quiet_NaN () };
 
     if (curr_world != "Skyrim" || !curr_cell.empty ())
     {
         player_location = glm::vec4 { std::numeric_limits<float>::quiet_NaN () };
+        discovered_from = player_location;
         return;
     }
-    player_location = glm::vec4 { curr_loc[0], curr_loc[1], curr_loc[2], curr_time };
+    player_location = glm::vec4 { curr_loc[0], curr_loc[1], curr_loc[2], float (curr_time) };
+
+    // The track takes the time in ticks straight from the game, the float days are for display
+    if (maptrack.enabled && std::isfinite (curr_time))
+    {
+        maptrack.track.add_point (player_location.xyz (), track_block::ticks (curr_time));
+        maptrack.discover (discovered_from, player_location);
+        discovered_from = player_location;
 
-    if (maptrack.enabled)
-        maptrack.track.add_point (player_location);
+        // The full blocks are packed away from the timer, one per job step
+        if (maptrack.track.unsealed () && !maptrack.jobs.pending ("Track packing"))
+            maptrack.jobs.submit ("Track packing", [] { return maptrack.track.seal_next (); });
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -199,49 +278,279 @@ draw_player (glm::vec2 const& wpos, glm::vec2 const& wsz,
 
 //--------------------------------------------------------------------------------------------------
 
+/// Copies prebuilt triangles into a draw list, scaled by @p m and moved by @p d. The indices less
+/// @p first are relative to the first of the vertices, hence these have to fit in ImDrawIdx.
+static void
+copy_triangles (ImDrawList* dl, ImDrawVert const* v, std::size_t nv,
+                ImDrawIdx const* i, std::size_t ni, glm::vec2 const& d, ImDrawIdx first = 0,
+                glm::vec2 const& m = glm::vec2 (1))
+{
+    if (!ni)
+        return;
+    imgui.ImDrawList_PrimReserve (dl, int (ni), int (nv));
+    if (m == glm::vec2 (1))
+        for (auto w = dl->_VtxWritePtr, e = w + nv; w != e; ++w, ++v)
+        {
+            *w = *v;
+            w->pos.x += d.x, w->pos.y += d.y;
+        }
+    else
+        for (auto w = dl->_VtxWritePtr, e = w + nv; w != e; ++w, ++v)
+        {
+            *w = *v;
+            w->pos.x = w->pos.x * m.x + d.x, w->pos.y = w->pos.y * m.y + d.y;
+        }
+    auto base = ImDrawIdx (dl->_VtxCurrentIdx - first);
+    for (auto w = dl->_IdxWritePtr, e = w + ni; w != e; ++w, ++i)
+        *w = ImDrawIdx (base + *i);
+    dl->_VtxWritePtr += nv;
+    dl->_IdxWritePtr += ni;
+    dl->_VtxCurrentIdx += unsigned (nv);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Draw commands of a map layer, kept in a draw list of their own and appended to the window one
+/// on every frame, until the layer changes and records them anew. A window move just places them.
+/// The geometry of each layer and its recording time are kept for the settings, so the cost of
+/// the map can be told apart in the game.
+class recorded_layer
+{
+    char const* name;
+    ImDrawList* list = nullptr;     ///< Lives as long as the plugin
+    glm::vec2 origin;               ///< Window position of the recording
+    std::vector<std::pair<ImDrawIdx, ImDrawIdx>> ranges;    ///< Of the vertices of each command
+    std::chrono::steady_clock::time_point started;
+    bool recording = false;
+    std::uint64_t recordings = 0;
+    double record_time = 0;         ///< Of all the recordings, in seconds
+
+public:
+
+    /// Of the last recording, the draw calls are the commands with any triangles
+    struct geometry
+    {
+        int draw_calls, vertices, triangles;
+    };
+
+    explicit recorded_layer (char const* name) : name (name) { layers ().push_back (this); }
+
+    bool empty () const { return !list; }
+
+    /// All the layers made so far, in the order of their first use
+    static std::vector<recorded_layer const*>& layers ()
+    {
+        static std::vector<recorded_layer const*> v;
+        return v;
+    }
+
+    char const* label () const { return name; }
+
+    geometry last_geometry () const
+    {
+        geometry g { 0, list ? list->VtxBuffer.Size : 0, list ? list->IdxBuffer.Size / 3 : 0 };
+        for (int k = 0; list && k < list->CmdBuffer.Size; ++k)
+            g.draw_calls += list->CmdBuffer.Data[k].ElemCount != 0;
+        return g;
+    }
+
+    /// Mean time of a recording, in seconds
+    double mean_record_time () const { return recordings ? record_time / recordings : 0; }
+
+    /// Starts a new recording, the returned draw list is valid until the next #splice()
+    ImDrawList* record (glm::vec2 const& wpos)
+    {
+        started = std::chrono::steady_clock::now ();
+        if (!list)
+            list = imgui.ImDrawList_ImDrawList (imgui.igGetDrawListSharedData ());
+        imgui.ImDrawList__ResetForNewFrame (list);
+        imgui.ImDrawList_PushClipRectFullScreen (list);
+        imgui.ImDrawList_PushTextureID (list, imgui.igGetIO ()->Fonts->TexID);
+        origin = wpos;
+        ranges.clear ();
+        recording = true;
+        return list;
+    }
+
+    /// Copies the commands into @p dl, moved to the window position @p wpos. Scaled by @p m from
+    /// it and moved by @p shift, these stand in for a new view until it is recorded, clipped to
+    /// the window too.
+    void splice (ImDrawList* dl, glm::vec2 const& wpos,
+                 glm::vec2 const& m = glm::vec2 (1), glm::vec2 const& shift = glm::vec2 (0))
+    {
+        if (!list)
+            return;
+        auto const now = std::chrono::steady_clock::now ();
+        if (recording)
+        {
+            // The vertices of a command are found once, its indices may be anywhere in them
+            ranges.clear ();
+            for (int k = 0; k < list->CmdBuffer.Size; ++k)
+            {
+                auto const& c = list->CmdBuffer.Data[k];
+                auto const i = list->IdxBuffer.Data + c.IdxOffset;
+                auto [lo, hi] = std::minmax_element (i, i + c.ElemCount);
+                ranges.emplace_back (c.ElemCount ? *lo : 0, c.ElemCount ? *hi : 0);
+            }
+            auto const t = std::chrono::duration<double> (now - started).count ();
+            map_layers.record_time += t, record_time += t;
+            ++map_layers.recorded, ++recordings;
+            recording = false;
+        }
+
+        auto const d = wpos - origin * m + shift;
+        bool const scaled = m != glm::vec2 (1);
+        for (int k = 0; k < list->CmdBuffer.Size; ++k)
+        {
+            auto const& c = list->CmdBuffer.Data[k];
+            if (!c.ElemCount || c.UserCallback)
+                continue;
+            auto const [lo, hi] = ranges[k];
+            imgui.ImDrawList_PushClipRect (dl,
+                    ImVec2 { c.ClipRect.x * m.x + d.x, c.ClipRect.y * m.y + d.y },
+                    ImVec2 { c.ClipRect.z * m.x + d.x, c.ClipRect.w * m.y + d.y }, scaled);
+            imgui.ImDrawList_PushTextureID (dl, c.TextureId);
+            copy_triangles (dl, list->VtxBuffer.Data + c.VtxOffset + lo, std::size_t (hi - lo) + 1,
+                            list->IdxBuffer.Data + c.IdxOffset, c.ElemCount, d, lo, m);
+            imgui.ImDrawList_PopTextureID (dl);
+            imgui.ImDrawList_PopClipRect (dl);
+        }
+        ++map_layers.spliced;
+        map_layers.splice_time += std::chrono::duration<double> (
+                std::chrono::steady_clock::now () - now).count ();
+    }
+};
+
 static void
 draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
             glm::vec2 const& uvtl, glm::vec2 const& uvbr,
             bool hovered)
 {
     constexpr float nan = std::numeric_limits<float>::quiet_NaN ();
+    constexpr std::uint32_t nowhere = ~std::uint32_t (0);
     struct icon_image {
-        ImVec2 tl, br, src; std::uint32_t tint, index;
+        ImVec2 tl, br, src; std::uint32_t tint, id;
+        std::uint32_t count;    ///< Of the icons in a cluster badge, otherwise 1, 0 once deleted
     };
     static struct {
         glm::vec2 wpos {nan}, wsz {nan}, uvtl {nan}, uvbr {nan};
         std::vector<icon_image> drawlist;
-        bool ico_updated = false;
+        std::vector<std::uint32_t> position;    ///< In #drawlist by icon id, of the ones in it
+        std::vector<std::uint32_t> visible;
+        std::vector<glm::vec2> corners;         ///< Of the visible icons, as projected
+        std::vector<bool> marked;
+        icon_grid grid;
+        int cluster_level = -1;
+        bool ico_updated = false, list_invalidated = false;
+        bool redraw = false;            ///< The draw list was changed in place
     } cached;
-    static decltype (maptrack.icons)::iterator ico = maptrack.icons.end ();
+    static recorded_layer layer ("Icons");
+    static decltype (maptrack.icons)::handle ico;
 
     map_project const mproj (wpos, wsz, uvtl, uvbr);
-    auto make_image = [&] (icon_t const& ico, std::uint32_t index)
+    auto make_image = [&] (icon_t const& ico, std::uint32_t id)
     {
         return icon_image {
             to_ImVec2 (mproj (ico.tl)),
             to_ImVec2 (mproj (ico.br)),
-            to_ImVec2 (ico.src), ico.tint, index
+            to_ImVec2 (ico.src), ico.tint, id, 1
         };
     };
+    auto clear_drawlist = [] ()
+    {
+        for (auto const& i: cached.drawlist)
+            cached.position[i.id] = nowhere;
+        cached.drawlist.clear ();
+    };
+    cached.position.resize (maptrack.icons.slot_count (), nowhere);
 
     bool window_moved = cached.wpos != wpos;
     bool window_resized = (cached.wsz != wsz || cached.uvtl != uvtl || cached.uvbr != uvbr);
 
-    if (window_resized || icons_invalidated)
+    if (icons_invalidated)
     {
-        if (icons_invalidated)
-            ico = maptrack.icons.end ();
-        icons_invalidated = false;
-        cached.drawlist.clear ();
+        ico = {};
+        cached.grid.clear ();
         for (std::size_t k = 0, n = maptrack.icons.size (); k < n; ++k)
         {
-            auto const& i = maptrack.icons[k];
-            if ((i.tl.x < uvbr.x) && (i.br.x > uvtl.x)
-             && (i.tl.y < uvbr.y) && (i.br.y > uvtl.y))
+            auto const& i = *(maptrack.icons.begin () + k);
+            cached.grid.insert (maptrack.icons.handle_of (k).slot, i.tl, i.br);
+        }
+    }
+
+    // Zoomed out for the grid cells, about the default icon size, to get smaller than a badge,
+    // the icons are drawn as clusters of about the badge size. Any change to an icon may change
+    // the look of its cluster.
+    constexpr float badge_size = 20;
+    float const cell_pixels = wsz.x / (uvbr.x - uvtl.x) / icon_grid::size;
+    cached.cluster_level = cell_pixels >= badge_size ? -1
+        : std::min (int (icon_grid::levels) - 1,
+                    int (std::ceil (std::log2 (badge_size / cell_pixels))));
+    if (cached.ico_updated && cached.cluster_level >= 0)
+        cached.ico_updated = false, cached.list_invalidated = true;
+
+    // Only the icons in view through the grid, drawn in the order of their ids
+    if ((window_resized || icons_invalidated || cached.list_invalidated)
+            && cached.cluster_level >= 0)
+    {
+        icons_invalidated = cached.list_invalidated = false;
+        cached.redraw = true;
+        clear_drawlist ();
+        cached.grid.query_clusters (unsigned (cached.cluster_level), uvtl, uvbr,
+                [&] (icon_grid::cluster const& c)
+        {
+            auto const& i = maptrack.icons[maptrack.icons.at_slot (c.first)];
+            if (c.count == 1)
             {
-                cached.drawlist.push_back (make_image (i, std::uint32_t (k)));
+                cached.drawlist.push_back (make_image (i, c.first));
+                return;
             }
+            auto const p = mproj (c.center ());
+            cached.drawlist.push_back (icon_image {
+                    to_ImVec2 (p - badge_size * .5f), to_ImVec2 (p + badge_size * .5f),
+                    to_ImVec2 (i.src), i.tint, c.first, c.count });
+        });
+    }
+    else if (window_resized || icons_invalidated || cached.list_invalidated)
+    {
+        icons_invalidated = cached.list_invalidated = false;
+        cached.redraw = true;
+        cached.visible.clear ();
+        bool const sorted = cached.grid.query (uvtl, uvbr,
+                [] (std::uint32_t k) { cached.visible.push_back (k); });
+        if (!sorted && cached.visible.size () * 16 < cached.position.size ())
+            std::sort (cached.visible.begin (), cached.visible.end ());
+        else if (!sorted)
+        {
+            // Too many to sort, rather by marks over all the ids
+            cached.marked.assign (cached.position.size (), false);
+            for (auto k: cached.visible)
+                cached.marked[k] = true;
+            cached.visible.clear ();
+            for (std::uint32_t k = 0, n = std::uint32_t (cached.marked.size ()); k < n; ++k)
+                if (cached.marked[k])
+                    cached.visible.push_back (k);
+        }
+        clear_drawlist ();
+
+        // The corners of them all projected at once
+        cached.corners.clear ();
+        for (auto k: cached.visible)
+        {
+            auto const& i = maptrack.icons[maptrack.icons.at_slot (k)];
+            cached.corners.push_back (i.tl);
+            cached.corners.push_back (i.br);
+        }
+        mproj.map_to_screen (cached.corners.data (), cached.corners.size (),
+                             cached.corners.data ());
+        for (std::size_t j = 0; j < cached.visible.size (); ++j)
+        {
+            auto const k = cached.visible[j];
+            auto const& i = maptrack.icons[maptrack.icons.at_slot (k)];
+            cached.position[k] = std::uint32_t (cached.drawlist.size ());
+            cached.drawlist.push_back (icon_image {
+                    to_ImVec2 (cached.corners[2 * j]), to_ImVec2 (cached.corners[2 * j + 1]),
+                    to_ImVec2 (i.src), i.tint, k, 1 });
         }
     }
     else if (window_moved)
@@ -256,31 +565,47 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
     else if (cached.ico_updated)
     {
         cached.ico_updated = false;
-        auto index = std::uint32_t (std::distance (maptrack.icons.begin (), ico));
-        for (auto& i: cached.drawlist)
-            if (i.index == index)
+        if (maptrack.icons.contains (ico))
+            if (auto k = cached.position[ico.slot]; k != nowhere)
             {
-                i = make_image (*ico, index);
-                break;
+                cached.drawlist[k] = make_image (maptrack.icons[ico], ico.slot);
+                cached.redraw = true;
             }
     }
     cached.wpos = wpos;
     cached.wsz = wsz, cached.uvtl = uvtl, cached.uvbr = uvbr;
 
-    // Draw here, before the GUI controls. Some sort of AABB tree would be nice.
+    // Draw here, before the GUI controls.
     // The clip rects cant be on top of all map draw routines as the GUI popup below may get out of
     // the map bounds when the mouse is clicked near the edges.
 
-    imgui.ImDrawList_PushClipRect (imgui.igGetWindowDrawList (),
-            to_ImVec2 (wpos), to_ImVec2 (wpos + wsz), false);
-    for (auto const& i: cached.drawlist)
+    if (cached.redraw || layer.empty ())
     {
-        imgui.ImDrawList_AddImage (imgui.igGetWindowDrawList (), maptrack.icon_atlas.ref,
-                i.tl, i.br, i.src,
-                ImVec2 { i.src.x + maptrack.icon_atlas.icon_uvsize,
-                         i.src.y + maptrack.icon_atlas.icon_uvsize }, i.tint);
+        cached.redraw = false;
+        auto dl = layer.record (wpos);
+        imgui.ImDrawList_PushClipRect (dl, to_ImVec2 (wpos), to_ImVec2 (wpos + wsz), false);
+        for (auto const& i: cached.drawlist)
+        {
+            if (!i.count)
+                continue;
+            imgui.ImDrawList_AddImage (dl, maptrack.icon_atlas.ref, i.tl, i.br, i.src,
+                    ImVec2 { i.src.x + maptrack.icon_atlas.icon_uvsize,
+                             i.src.y + maptrack.icon_atlas.icon_uvsize }, i.tint);
+        }
+
+        // The counts of the badges over all the images, as one command of the font texture rather
+        // than one after each of them
+        for (auto const& i: cached.drawlist)
+        {
+            if (i.count < 2)
+                continue;
+            char count[16];
+            auto end = std::to_chars (count, count + sizeof (count), i.count).ptr;
+            imgui.ImDrawList_AddText_Vec2 (dl, i.tl, IM_COL32_WHITE, count, end);
+        }
+        imgui.ImDrawList_PopClipRect (dl);
     }
-    imgui.ImDrawList_PopClipRect (imgui.igGetWindowDrawList ());
+    layer.splice (imgui.igGetWindowDrawList (), wpos);
 
     // Clicking on existing icon, sets it for modification. Otherwise, create new one by copying
     // the last one selected (if any) - this is for rapid multiplication across the map.
@@ -292,25 +617,22 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
     {
         auto tpos = mproj.screen_to_map (to_vec2 (io->MousePos));
 
-        auto it = std::find_if (maptrack.icons.begin (), maptrack.icons.end (),
-                [tpos] (icon_t const& i)
-                {
-                    return (i.tl.x <= tpos.x) && (i.tl.y <= tpos.y)
-                        && (i.br.x >= tpos.x) && (i.br.y >= tpos.y);
-                });
+        // The one of the lowest id, as it is drawn below the others
+        auto const hit = cached.grid.lowest (tpos);
 
-        if (it != maptrack.icons.end ())
-            ico = it;
+        if (hit != nowhere)
+            ico = maptrack.icons.at_slot (hit);
         else
         {
             icon_t i;
             float half;
-            if (ico != maptrack.icons.end ())
+            if (maptrack.icons.contains (ico))
             {
-                half = (ico->br - ico->tl).x * .5f;
-                i.src = ico->src;
-                i.tint = ico->tint;
-                i.index = ico->index;
+                auto const& last = maptrack.icons[ico];
+                half = (last.br - last.tl).x * .5f;
+                i.src = last.src;
+                i.tint = last.tint;
+                i.index = last.index;
             }
             else
             {
@@ -322,27 +644,45 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
             i.tl = tpos - half;
             i.br = tpos + half;
             i.atlas = maptrack.icon_atlas.uid;
-            ico = maptrack.icons.insert (maptrack.icons.end (), i);
-            cached.drawlist.push_back (make_image (i, maptrack.icons.size () - 1));
+            ico = maptrack.icons.insert (i);
+            cached.grid.insert (ico.slot, i.tl, i.br);
+            cached.position.resize (maptrack.icons.slot_count (), nowhere);
+            if (cached.cluster_level >= 0)
+                cached.list_invalidated = true;
+            else
+            {
+                cached.position[ico.slot] = std::uint32_t (cached.drawlist.size ());
+                cached.drawlist.push_back (make_image (i, ico.slot));
+                cached.redraw = true;
+            }
         }
-        ico->text.resize (max_text);
+        maptrack.icons[ico].text.resize (max_text);
         imgui.igOpenPopup_Str ("Setup icon", 0);
     }
 
     if (imgui.igBeginPopup ("Setup icon", 0))
     {
+        // Gone with a load or clear of the icons
+        if (!maptrack.icons.contains (ico))
+        {
+            imgui.igCloseCurrentPopup ();
+            imgui.igEndPopup ();
+            return;
+        }
+        auto& icon = maptrack.icons[ico];
+
         static const std::string name = "out of " + std::to_string (maptrack.icon_atlas.icon_count);
 
-        imgui.igInputText ("Small text##icon", &ico->text[0], max_text, 0, nullptr, nullptr);
+        imgui.igInputText ("Small text##icon", &icon.text[0], max_text, 0, nullptr, nullptr);
 
-        int user_index = ico->index + 1;
+        int user_index = icon.index + 1;
         if (imgui.igDragInt (name.c_str (), &user_index, 1, 1, maptrack.icon_atlas.icon_count, "%d", 0))
         {
             cached.ico_updated = true;
-            ico->index = glm::clamp (1, user_index, int (maptrack.icon_atlas.icon_count)) - 1;
-            ico->src = maptrack.icon_atlas.icon_uvsize * glm::vec2 {
-                ico->index % maptrack.icon_atlas.stride,
-                ico->index / maptrack.icon_atlas.stride };
+            icon.index = glm::clamp (1, user_index, int (maptrack.icon_atlas.icon_count)) - 1;
+            icon.src = maptrack.icon_atlas.icon_uvsize * glm::vec2 {
+                icon.index % maptrack.icon_atlas.stride,
+                icon.index / maptrack.icon_atlas.stride };
         }
 
         constexpr int colflags = ImGuiColorEditFlags_Float | ImGuiColorEditFlags_DisplayHSV
@@ -350,26 +690,28 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
             | ImGuiColorEditFlags_AlphaBar;
 
         ImVec4 color;
-        imgui.igColorConvertU32ToFloat4 (&color, ico->tint);
+        imgui.igColorConvertU32ToFloat4 (&color, icon.tint);
         if (imgui.igColorEdit4 ("Tint##icon", (float*) &color, colflags))
         {
             cached.ico_updated = true;
-            ico->tint = imgui.igGetColorU32_Vec4 (color);
+            icon.tint = imgui.igGetColorU32_Vec4 (color);
         }
 
-        float scale = (ico->br - ico->tl).x * maptrack.icon_atlas.icon_size;
+        float scale = (icon.br - icon.tl).x * maptrack.icon_atlas.icon_size;
         if (imgui.igSliderFloat ("Scale##icon", &scale, .25f, 4.f, "%.2f", 1))
         {
             cached.ico_updated = true;
             float half = glm::clamp (.25f, scale, 4.f) * .5f * icon_atlas_t::default_uvsize;
-            glm::vec2 c = .5f * (ico->tl + ico->br);
-            ico->tl = c - half;
-            ico->br = c + half;
+            glm::vec2 c = .5f * (icon.tl + icon.br);
+            auto tl = icon.tl, br = icon.br;
+            icon.tl = c - half;
+            icon.br = c + half;
+            cached.grid.move (ico.slot, tl, br, icon.tl, icon.br);
         }
 
         if (imgui.igButton ("Open in Journal", ImVec2 {}))
         {
-            if (dispatch_journal (ico->text))
+            if (dispatch_journal (icon.text))
                 imgui.igCloseCurrentPopup ();
         }
 
@@ -380,14 +722,23 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
         {
             if (imgui.igButton ("Confirm##icon", ImVec2 {}))
             {
+                // Its image stays in the list until the next rebuild, just not drawn
+                cached.grid.remove (ico.slot, icon.tl, icon.br);
+                if (cached.cluster_level >= 0)
+                    cached.list_invalidated = true;
+                else if (auto& k = cached.position[ico.slot]; k != nowhere)
+                {
+                    cached.drawlist[k].count = 0;
+                    cached.redraw = true;
+                    k = nowhere;
+                }
                 maptrack.icons.erase (ico);
-                icons_invalidated = true;
                 imgui.igCloseCurrentPopup ();
             }
             imgui.igEndPopup ();
         }
         // Have to close and the parent popup after deletion as it references ico all around
-        if (ico == maptrack.icons.end ())
+        if (!maptrack.icons.contains (ico))
             imgui.igCloseCurrentPopup ();
 
         imgui.igEndPopup ();
@@ -396,61 +747,800 @@ draw_icons (glm::vec2 const& wpos, glm::vec2 const& wsz,
 
 //--------------------------------------------------------------------------------------------------
 
+/// How ImGui would draw an anti-aliased line
+struct line_style
+{
+    float width;
+    ImU32 color;
+    bool textured;          ///< Through the prebaked texture of its whole pixel width
+    ImVec4 uvs;             ///< Texture coordinates of both of its edges, else of the white pixel
+
+    bool operator != (line_style const& o) const
+    {
+        return width != o.width || color != o.color || textured != o.textured
+            || uvs.x != o.uvs.x || uvs.y != o.uvs.y || uvs.z != o.uvs.z || uvs.w != o.uvs.w;
+    }
+};
+
+/// Screen track of a range, kept as one span per store block so that when the range changes only
+/// the blocks on its ends have to be projected again. Each span reaches to the first point of the
+/// next block. The polylines in it are each preceded by a NaN point, and are tessellated into
+/// anti-aliased thick lines once, relative to the window position they were projected for. The
+/// spans hold their own triangles, so that these are made apart on the threads of the pool.
+struct screen_track
+{
+    struct span
+    {
+        std::size_t first, last;    ///< Point indices
+        std::size_t offset;         ///< Into #points
+        bool complete;              ///< One polyline of each point, hence any prefix is valid too
+        std::vector<ImDrawVert> vertices;
+        std::vector<ImDrawIdx> indices;     ///< Relative to the first vertex of the span
+    };
+    std::vector<span> spans;
+    std::vector<glm::vec2> points;
+    std::vector<span> spare;            ///< Dropped, to take the memory of their triangles
+
+    glm::vec2 origin;                   ///< Window position of the projection
+    line_style style;
+
+    /// Projects [first, last) anew, reusing the spans of the blocks which are still the same.
+    /// Points at index changed or later are considered rewritten. The NaN breaks stay NaN through
+    /// the projection. Only the segments which may cross the game XY box [lo, hi] are taken.
+    void update (track_t::const_iterator first, track_t::const_iterator last, unsigned level,
+                 std::size_t changed, glm::vec2 const& lo, glm::vec2 const& hi,
+                 map_project const& proj)
+    {
+        constexpr float nan = std::numeric_limits<float>::quiet_NaN ();
+        auto fp = first.position (), lp = last.position ();
+        auto bounds = [fp, lp] (std::size_t b)
+        {
+            auto o = b << track_block::bits;
+            return std::make_pair (std::max (fp, o), std::min (lp, o + track_block::size + 1));
+        };
+        auto more = [fp, lp] (std::size_t b) {
+            return std::max (fp, b << track_block::bits) + 1 < lp;
+        };
+        std::size_t skip = lp, runs = 0;
+        auto emit = [&] (glm::vec2 const& p, std::size_t i, bool joined)
+        {
+            if (i == skip)
+                return;
+            if (!joined)
+                points.push_back (glm::vec2 (nan)), ++runs;
+            points.push_back (p);
+        };
+        auto visit = [&] (std::size_t f, std::size_t l, unsigned k)
+        {
+            track_t::for_each_lod_point (first + (f - fp), first + (l - fp), k, lo, hi, emit);
+        };
+
+        // The leading spans which are still the same stay in place, hence appending to the range
+        // copies nothing. The rest is set aside and taken from as far as it is still valid.
+        auto b = fp >> track_block::bits;
+        std::size_t k = 0;
+        for (; k < spans.size () && more (b); ++k, ++b)
+        {
+            auto [f, l] = bounds (b);
+            if (spans[k].first != f || spans[k].last != l || l > changed)
+                break;
+        }
+        auto const base = k < spans.size () ? spans[k].offset : points.size ();
+        std::vector<span> rest (std::make_move_iterator (spans.begin () + k),
+                                std::make_move_iterator (spans.end ()));
+        std::vector<glm::vec2> restp (points.cbegin () + base, points.cend ());
+        spans.resize (k);
+        points.resize (base);
+
+        // Of each new span, the points from which on it is yet to be projected, if any
+        constexpr std::size_t done = std::numeric_limits<std::size_t>::max ();
+        std::vector<std::size_t> raw;
+
+        auto old = rest.begin ();
+        for (; more (b); ++b)
+        {
+            auto [f, l] = bounds (b);
+            span s { f, l, points.size (), false, {}, {} };
+            if (!spare.empty ())
+            {
+                s.vertices.swap (spare.back ().vertices);
+                s.indices.swap (spare.back ().indices);
+                spare.pop_back ();
+            }
+
+            while (old != rest.end () && (old->first >> track_block::bits) < b)
+                ++old;
+            auto valid = s.first;   // Points before it are taken from the old span
+            bool kept = false;      // With its triangles
+            if (old != rest.end () && old->first == s.first)
+            {
+                if (old->last == s.last && s.last <= changed)
+                {
+                    // As it is, with its triangles
+                    auto next = old + 1 == rest.end () ? restp.size () + base : old[1].offset;
+                    valid = s.last, kept = true;
+                    points.insert (points.end (), restp.cbegin () + (old->offset - base),
+                                                  restp.cbegin () + (next - base));
+                    s.vertices.swap (old->vertices);
+                    s.indices.swap (old->indices);
+                    s.complete = old->complete;
+                }
+                else if (old->complete)
+                {
+                    valid = std::max (s.first, std::min ({ old->last, s.last, changed }));
+                    auto from = restp.cbegin () + (old->offset - base);
+                    if (valid > s.first)
+                        points.insert (points.end (), from, from + (valid - s.first + 1));
+                    s.complete = true;
+                }
+            }
+            raw.push_back (kept ? done : points.size ());
+            runs = 0;
+            if (valid == s.first)
+            {
+                visit (s.first, s.last, level);
+                s.complete = runs == 1 && points.size () - s.offset == s.last - s.first + 1;
+            }
+            else if (valid < s.last)
+            {
+                // Only the complete spans get here, these go on from their last point
+                skip = valid - 1;
+                visit (skip, s.last, 0);
+                skip = lp;
+                s.complete = !runs && points.size () - s.offset == s.last - s.first + 1;
+            }
+            spans.push_back (std::move (s));
+        }
+        drop (rest);
+
+        // The store is read above on this thread only, as it decodes into shared caches, while
+        // the new spans are projected and tessellated by the workers too
+        auto const n = raw.size ();
+        workers ().parallel_for (0, n, [&] (std::size_t j)
+        {
+            if (raw[j] == done)
+                return;
+            auto& s = spans[k + j];
+            auto const e = j + 1 < n ? spans[k + j + 1].offset : points.size ();
+            proj.game_to_screen (points.data () + raw[j], e - raw[j], points.data () + raw[j]);
+            tessellate (points.cbegin () + s.offset, points.cbegin () + e, s.vertices, s.indices);
+        });
+    }
+
+    /// Copies the triangles into a draw list, moved by @p d
+    void draw (ImDrawList* dl, glm::vec2 const& d) const
+    {
+        for (auto const& s: spans)
+            copy_triangles (dl, s.vertices.data (), s.vertices.size (),
+                                s.indices.data (), s.indices.size (), d);
+    }
+
+    void clear (glm::vec2 const& wpos, line_style const& line)
+    {
+        drop (spans);
+        points.clear ();
+        origin = wpos, style = line;
+    }
+
+private:
+
+    void drop (std::vector<span>& v)
+    {
+        for (auto& s: v)
+        {
+            s.vertices.clear ();
+            s.indices.clear ();
+            spare.push_back (std::move (s));
+        }
+        v.clear ();
+    }
+
+    /// The polylines of a span as ImGui does: on the mitered normals of their segments, two
+    /// vertices per point at the edges of the line texture, else four with a core of the line
+    /// width faded out over a pixel on both sides.
+    void tessellate (std::vector<glm::vec2>::const_iterator first,
+                     std::vector<glm::vec2>::const_iterator last,
+                     std::vector<ImDrawVert>& vertices, std::vector<ImDrawIdx>& indices) const
+    {
+        constexpr float max_miter = 100;    // Inverse squared length of the averaged normal
+        auto const& l = style;
+
+        // The vertices across the line at each point
+        struct { float offset; ImVec2 uv; ImU32 col; } across[4];
+        std::size_t stride = l.textured ? 2 : 4;
+        if (l.textured)
+        {
+            float half = l.width * .5f + 1;
+            across[0] = {  half, { l.uvs.x, l.uvs.y }, l.color };
+            across[1] = { -half, { l.uvs.z, l.uvs.w }, l.color };
+        }
+        else
+        {
+            float inner = std::max (0.f, (l.width - 1) * .5f), outer = inner + 1;
+            auto fade = l.color & ~IM_COL32_A_MASK;
+            ImVec2 uv { l.uvs.x, l.uvs.y };
+            across[0] = {  outer, uv, fade };
+            across[1] = {  inner, uv, l.color };
+            across[2] = { -inner, uv, l.color };
+            across[3] = { -outer, uv, fade };
+        }
+
+        auto normal = [] (glm::vec2 const& a, glm::vec2 const& b)
+        {
+            auto d = b - a;
+            float l2 = glm::dot (d, d);
+            return l2 > 0 ? glm::vec2 (d.y, -d.x) / std::sqrt (l2) : glm::vec2 (0);
+        };
+        auto is_break = [] (glm::vec2 const& p) { return std::isnan (p.x); };
+        for (auto it = first; it != last; )
+        {
+            auto end = std::find_if (++it, last, is_break);
+            auto n = std::size_t (end - it);
+            if (n < 2)
+            {
+                it = end;
+                continue;
+            }
+
+            auto v0 = vertices.size ();
+            vertices.resize (v0 + n * stride);
+            auto v = vertices.data () + v0;
+            auto nb = normal (it[0], it[1]);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                auto na = nb;
+                if (i && i + 1 < n)
+                    nb = normal (it[i], it[i + 1]);
+                auto m = (na + nb) * .5f;
+                if (float l2 = glm::dot (m, m); l2 > 1e-6f)
+                    m *= std::min (1 / l2, max_miter);
+                for (std::size_t j = 0; j < stride; ++j)
+                    *v++ = ImDrawVert { to_ImVec2 (it[i] + m * across[j].offset),
+                                        across[j].uv, across[j].col };
+            }
+
+            // Two triangles between each two vertices across, and the two next to them
+            auto i0 = indices.size ();
+            indices.resize (i0 + (n - 1) * (stride - 1) * 6);
+            auto w = indices.data () + i0;
+            for (auto a = v0, e = a + (n - 1) * stride; a < e; a += stride)
+            {
+                for (auto j = a, b = a + stride; j + 1 < a + stride; ++j, ++b, w += 6)
+                {
+                    w[0] = ImDrawIdx (j), w[1] = ImDrawIdx (j + 1), w[2] = ImDrawIdx (b + 1);
+                    w[3] = ImDrawIdx (j), w[4] = ImDrawIdx (b + 1), w[5] = ImDrawIdx (b);
+                }
+            }
+            it = end;
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// The tessellation of a track window, kept from frame to frame, and its recorded layer. A new
+/// view is projected into #next by a job, while the layer of the former one is drawn scaled.
+struct track_drawing
+{
+    static constexpr float nan = std::numeric_limits<float>::quiet_NaN ();
+    glm::vec2 wsz {nan}, uvtl {nan}, uvbr {nan};
+    screen_track uvtrack;
+    recorded_layer layer;
+
+    glm::vec2 next_wsz {nan}, next_uvtl {nan}, next_uvbr {nan};
+    screen_track next;
+    bool swapped = false;               ///< The next one took the place, to be recorded
+    std::string job;
+
+    explicit track_drawing (char const* name)
+        : layer (name), job (std::string ("Reprojecting ") + name) {}
+};
+
+/// Of a view, the level of detail of its zoom and the visible part of the map in game units, with
+/// a margin for the line width and the error of that level
+static std::tuple<unsigned, glm::vec2, glm::vec2>
+track_view (glm::vec2 const& wsz, glm::vec2 const& uvtl, glm::vec2 const& uvbr)
+{
+    glm::vec2 ppu = glm::abs (wsz / (uvbr - uvtl) * maptrack.scale);
+    auto level = track_t::lod_level (std::max (ppu.x, ppu.y));
+    auto a = maptrack.map_to_game (uvtl), b = maptrack.map_to_game (uvbr);
+    auto margin = track_lod::error (level) + maptrack.track_width / std::min (ppu.x, ppu.y);
+    return { level, glm::min (a, b) - margin, glm::max (a, b) + margin };
+}
+
+/// Projects the range for a new view in a job, a few blocks per step from its first point, as the
+/// range may change meanwhile. At the end the result takes the place of the drawn one.
 static void
-draw_track (glm::vec2 const& wpos, glm::vec2 const& wsz,
+reproject_track (track_window& range, track_drawing& cached, glm::vec2 const& wpos,
+                 glm::vec2 const& wsz, glm::vec2 const& uvtl, glm::vec2 const& uvbr)
+{
+    constexpr std::size_t job_points = std::size_t (1) << 14;
+    cached.next_wsz = wsz, cached.next_uvtl = uvtl, cached.next_uvbr = uvbr;
+    cached.next.clear (wpos, cached.uvtrack.style);
+    auto const [level, lo, hi] = track_view (wsz, uvtl, uvbr);
+    maptrack.jobs.submit (cached.job, [&range, &cached, level = level, lo = lo, hi = hi,
+                                       proj = map_project (wpos, wsz, uvtl, uvbr),
+                                       done = std::size_t (0)] () mutable
+    {
+        // The changes seen so far are in the next spans already
+        constexpr auto none = std::numeric_limits<std::size_t>::max ();
+        auto const changed = std::exchange (range.changed, none);
+        auto const fp = range.first.position (), lp = range.second.position ();
+        done = std::min (lp, std::max (done, fp) + job_points);
+        cached.next.update (range.first, range.first + (done - fp), level, changed, lo, hi, proj);
+        if (done < lp)
+            return true;
+        std::swap (cached.uvtrack, cached.next);
+        cached.wsz = cached.next_wsz;
+        cached.uvtl = cached.next_uvtl, cached.uvbr = cached.next_uvbr;
+        cached.swapped = true;
+        return false;
+    });
+}
+
+static void
+draw_track (track_window& range, std::uint32_t color, track_drawing& cached,
+            glm::vec2 const& wpos, glm::vec2 const& wsz,
             glm::vec2 const& uvtl, glm::vec2 const& uvbr)
 {
-    constexpr float nan = std::numeric_limits<float>::quiet_NaN ();
-    static struct
+    if (range.first == range.second)
+        return;
+
+    // As for ImGui, lines of a whole pixel width go through its prebaked texture
+    constexpr int tex_lines_width_max = 63;
+    auto dl = imgui.igGetWindowDrawList ();
+    line_style line { maptrack.track_width, color, false, {} };
+    if (int w = int (line.width); w == line.width && w <= tex_lines_width_max
+            && (dl->Flags & ImDrawListFlags_AntiAliasedLinesUseTex))
     {
-        glm::vec2 wpos {nan}, wsz {nan}, uvtl {nan}, uvbr {nan};
-        std::vector<glm::vec2> uvtrack;
+        line.textured = true;
+        line.uvs = dl->_Data->TexUvLines[w];
+    }
+    else
+    {
+        ImVec2 white;
+        imgui.igGetFontTexUvWhitePixel (&white);
+        line.uvs = ImVec4 { white.x, white.y, white.x, white.y };
     }
-    cached;
 
-    if (!maptrack.track_enabled || track_range.first == track_range.second)
+    auto& t = cached.uvtrack;
+    auto& layer = cached.layer;
+    bool restyled = t.style != line;
+    bool window_resized = (cached.wsz != wsz || cached.uvtl != uvtl || cached.uvbr != uvbr);
+
+    // Zoom and resize change every point, hence these are projected by a job, while the former
+    // triangles are drawn scaled to the new view. The job starts over as long as the view keeps
+    // changing.
+    if (window_resized && !restyled && !layer.empty ())
+    {
+        if (!maptrack.jobs.pending (cached.job) || cached.next_wsz != wsz
+                || cached.next_uvtl != uvtl || cached.next_uvbr != uvbr)
+            reproject_track (range, cached, wpos, wsz, uvtl, uvbr);
+        auto const k0 = cached.wsz / (cached.uvbr - cached.uvtl), k = wsz / (uvbr - uvtl);
+        layer.splice (dl, wpos, k / k0, (cached.uvtl - uvtl) * k);
         return;
+    }
 
-    bool window_moved = (cached.wpos != wpos);
-    bool window_resized = (cached.wsz != wsz || cached.uvtl != uvtl || cached.uvbr != uvbr);
+    // Back to the drawn view before the job ended, the changes it took are projected anew
+    if (maptrack.jobs.pending (cached.job))
+        maptrack.jobs.cancel (cached.job), window_resized = true;
+
+    // A new look, or the first view, changes every point at once, while for a new range or new
+    // points only the blocks which differ are projected and tessellated. Only the points which
+    // make a difference on the screen are taken, through the level of detail of the current
+    // zoom, and only the groups of them which are in view. A window move just places the
+    // triangles.
+    if (window_resized || restyled)
+        t.clear (wpos, line);
+    bool const redraw = window_resized || restyled || range.draw_invalidated;
+    if (redraw)
+    {
+        auto const [level, lo, hi] = track_view (wsz, uvtl, uvbr);
+        t.update (range.first, range.second, level, range.changed, lo, hi,
+                  map_project (t.origin, wsz, uvtl, uvbr));
+        range.changed = std::numeric_limits<std::size_t>::max ();
+    }
 
-    // Best case for update.
-    if (window_moved && !window_resized && !track_range.draw_invalidated)
+    if (redraw || layer.empty () || cached.swapped)
     {
-        auto d = wpos - cached.wpos;
-        for (auto& p: cached.uvtrack)
-            p += d;
+        auto rdl = layer.record (wpos);
+        imgui.ImDrawList_PushClipRect (rdl, to_ImVec2 (wpos), to_ImVec2 (wpos+wsz), false);
+        t.draw (rdl, wpos - t.origin);
+        imgui.ImDrawList_PopClipRect (rdl);
+        cached.swapped = false;
+    }
+    layer.splice (dl, wpos);
+
+    cached.wsz = wsz, cached.uvtl = uvtl, cached.uvbr = uvbr;
+    range.draw_invalidated = false;
+}
+
+/// The track range, over the one before it when compared
+static void
+draw_track (glm::vec2 const& wpos, glm::vec2 const& wsz,
+            glm::vec2 const& uvtl, glm::vec2 const& uvbr)
+{
+    static track_drawing current ("Track"), previous ("Previous");
+    if (!maptrack.track_enabled)
+        return;
+    if (maptrack.compare.enabled)
+        draw_track (compare_range, maptrack.compare.color, previous, wpos, wsz, uvtl, uvbr);
+    draw_track (track_range, maptrack.track_color, current, wpos, wsz, uvtl, uvbr);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/// Fog of war cells of a track range, uncovered by a disc around each point and around the player,
+/// and along the segments between the points. The points are stamped as they are added to the
+/// range, the discs once per distinct cell. The cells can be stamped by bands of rows at once.
+struct fog_grid
+{
+    int resolution = 0;
+    std::vector<std::uint8_t> cells;    ///< Alpha of each cell
+    std::vector<std::uint8_t> tracked;  ///< Cells uncovered by the track, not packed as these
+                                        ///< are written by the rows from many threads
+    std::vector<bool> centers;          ///< Cells which had a disc stamped on
+    std::vector<int> stencil;           ///< Half width of each row of the disc, from its top
+    std::uint8_t default_alpha, tracked_alpha, player_alpha;
+    float teleport;                     ///< Game distance from which segments are jumps
+
+    std::size_t first = 0, last = 0;    ///< Stamped point indices
+    glm::ivec2 player;                  ///< Cell of the player disc, if any
+
+    static constexpr glm::ivec2 nowhere { std::numeric_limits<int>::min () };
+
+    void reset (int res, int discover, std::uint8_t fog, std::uint8_t track, std::uint8_t near,
+                float jump, std::size_t position)
+    {
+        resolution = res;
+        cells.assign (res * res, fog);
+        tracked.assign (res * res, 0);
+        centers.assign (res * res, false);
+        default_alpha = fog, tracked_alpha = track, player_alpha = near;
+        teleport = jump;
+        first = last = position;
+        player = nowhere;
+
+        // The cells closer than the discover radius
+        stencil.clear ();
+        for (int dy = -discover; dy <= discover; ++dy)
+        {
+            int w = -1;
+            while ((w + 1) * (w + 1) + dy * dy < discover * discover)
+                ++w;
+            stencil.push_back (w);
+        }
     }
 
-    // Currently, no idea how to speed up on range change only, hence consider full recalc as it
-    // is when the window is resized. Gladly, the range is done only once while the map is visible
-    // if the player is not on auto-move.
-    else if (window_resized || track_range.draw_invalidated)
+    /// Whether a track point has yet to stamp its disc, the ones out of the grid always have
+    bool claim (glm::ivec2 const& c)
     {
-        cached.uvtrack.resize (std::distance (track_range.first, track_range.second));
-        std::transform (
-                track_range.first, track_range.second, cached.uvtrack.begin (),
-                map_project (wpos, wsz, uvtl, uvbr));
+        if (!inside (c))
+            return true;
+        if (centers[c.x + c.y * resolution])
+            return false;
+        centers[c.x + c.y * resolution] = true;
+        return true;
     }
 
-    imgui.ImDrawList_PushClipRect (imgui.igGetWindowDrawList (),
-            to_ImVec2 (wpos), to_ImVec2 (wpos+wsz), false);
+    /// Stamps the disc of a track point, over the rows [y0, y1) of it
+    void disc (glm::ivec2 const& c, int y0, int y1)
+    {
+        for_each_cell (c, [this] (std::size_t i) { tracked[i] = 1, cells[i] = tracked_alpha; },
+                       y0, y1);
+    }
+
+    /// Stamps the cells closer than the discover radius to the segment between two track points,
+    /// as the discs would along it, over the rows [y0, y1). Steps along its major axis as
+    /// Bresenham does, filling the span of the cells of each step.
+    void segment (glm::ivec2 const& a, glm::ivec2 const& b, int y0, int y1)
+    {
+        auto const d = b - a;
+        int const u = std::abs (d.y) > std::abs (d.x), v = 1 - u;   // The major and minor axis
+        int const du = std::abs (d[u]), dv = std::abs (d[v]);
+        if (!du)
+            return;
+
+        // On a step, the cells are less than the radius away from the line, which is longer along
+        // the minor axis as the line gets steeper, and project within the segment. The ends reach
+        // past the end points on steep lines.
+        int const r = int (stencil.size () / 2);
+        float const l2 = glm::dot (glm::vec2 (d), glm::vec2 (d)), h = r * std::sqrt (l2) / du;
+        int const ends = int (std::ceil (r * dv / std::sqrt (l2)));
+        int const su = d[u] < 0 ? -1 : 1;
+        glm::ivec2 const from (0, y0), to (resolution, y1);
+        glm::ivec2 c;
+        for (int k = -ends; k <= du + ends; ++k)
+        {
+            c[u] = a[u] + su * k;
+            if (c[u] < from[u] || c[u] >= to[u])
+                continue;
+
+            // Across the line, then along it as of the projection to the segment
+            float const m = a[v] + float (d[v]) * k / du;
+            float lo = std::floor (m - h) + 1, hi = std::ceil (m + h) - 1;
+            if (d[v])
+            {
+                float p0 = a[v] - float (k * du) / d[v], p1 = a[v] + (l2 - k * du) / d[v];
+                lo = std::max (lo, std::ceil (std::min (p0, p1)));
+                hi = std::min (hi, std::floor (std::max (p0, p1)));
+            }
+            else if (k < 0 || k > du)
+                continue;
 
-    int splits = 10000;
-    auto div = std::div (int (cached.uvtrack.size ()), splits);
-    for (int i = 0; i < div.quot; ++i)
+            int const c1 = std::min (to[v] - 1, int (hi));
+            for (c[v] = std::max (from[v], int (lo)); c[v] <= c1; ++c[v])
+            {
+                auto i = std::size_t (c.x + c.y * resolution);
+                tracked[i] = 1, cells[i] = tracked_alpha;
+            }
+        }
+    }
+
+    /// Moves the player disc, the cells it leaves go back to as the track left them
+    void move_player (glm::ivec2 const& c)
     {
-        imgui.ImDrawList_AddPolyline (imgui.igGetWindowDrawList (),
-                reinterpret_cast<ImVec2 const*> (cached.uvtrack.data () + i*splits), splits,
-                maptrack.track_color, false, maptrack.track_width);
+        if (player != nowhere)
+            for_each_cell (player, [this] (std::size_t i) {
+                cells[i] = tracked[i] ? tracked_alpha : default_alpha;
+            });
+        if ((player = c) != nowhere)
+            for_each_cell (player, [this] (std::size_t i) { cells[i] = player_alpha; });
     }
-    imgui.ImDrawList_AddPolyline (imgui.igGetWindowDrawList (),
-            reinterpret_cast<ImVec2 const*> (cached.uvtrack.data () + div.quot*splits), div.rem,
-            maptrack.track_color, false, maptrack.track_width);
-    imgui.ImDrawList_PopClipRect (imgui.igGetWindowDrawList ());
 
-    cached.wpos = wpos, cached.wsz = wsz, cached.uvtl = uvtl, cached.uvbr = uvbr;
-    track_range.draw_invalidated = false;
+private:
+
+    bool inside (glm::ivec2 const& c) const
+    {
+        return c.x >= 0 && c.x < resolution && c.y >= 0 && c.y < resolution;
+    }
+
+    template<class F>
+    void for_each_cell (glm::ivec2 const& c, F&& f,
+                        int y0 = 0, int y1 = std::numeric_limits<int>::max ()) const
+    {
+        int const r = int (stencil.size () / 2);
+        y0 = std::max (y0, 0), y1 = std::min (y1, resolution);
+        for (int dy = std::max (-r, y0 - c.y); dy <= r; ++dy)
+        {
+            int y = c.y + dy, w = stencil[dy + r];
+            if (y >= y1)
+                break;
+            if (w < 0)
+                continue;
+            int x0 = std::max (0, c.x - w), x1 = std::min (resolution - 1, c.x + w);
+            for (int x = x0; x <= x1; ++x)
+                f (std::size_t (x + y * resolution));
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Fog of war over a window of cells, as rectangles of equal alpha: the runs of each row, merged
+/// with the runs of the same extent in the rows below.
+struct fog_mesh
+{
+    static constexpr std::size_t batch = 1 << 14;   ///< Rectangles with indices of the same base
+
+    std::vector<ImDrawVert> vertices;
+    std::vector<ImDrawIdx> indices;     ///< Relative to the first vertex of their batch
+    glm::vec2 origin;                   ///< Window position of the projection
+    std::vector<glm::vec2> corners;     ///< Top left and bottom right of each rectangle
+    std::vector<std::uint8_t> alphas;
+
+    /// Cells [lo, hi) of a grid, as of their @p alpha (x, y), mapped to the screen through @p proj.
+    /// The rectangles are gathered first, to be projected at once.
+    template<class Alpha>
+    void build (Alpha&& alpha, glm::ivec2 const& lo, glm::ivec2 const& hi,
+                glm::vec2 const& step, map_project const& proj, glm::vec2 const& wpos)
+    {
+        struct rect { int x0, x1, y0, y1; std::uint8_t alpha; };
+        std::vector<rect> open, next;
+        vertices.clear ();
+        indices.clear ();
+        corners.clear ();
+        alphas.clear ();
+        origin = wpos;
+
+        auto emit = [&] (rect const& r)
+        {
+            if (!r.alpha)
+                return;
+            corners.push_back (glm::vec2 (r.x0, r.y0) * step);
+            corners.push_back (glm::vec2 (r.x1, r.y1) * step);
+            alphas.push_back (r.alpha);
+        };
+
+        for (int y = lo.y; y < hi.y; ++y)
+        {
+            auto o = open.cbegin ();
+            for (int x = lo.x; x < hi.x; )
+            {
+                rect r { x, x + 1, y, y + 1, alpha (x, y) };
+                while (r.x1 < hi.x && alpha (r.x1, y) == r.alpha)
+                    ++r.x1;
+                x = r.x1;
+
+                // Both the runs and the open rectangles are sorted by their start
+                for (; o != open.cend () && o->x0 < r.x0; ++o)
+                    emit (*o);
+                if (o != open.cend () && o->x0 == r.x0 && o->x1 == r.x1 && o->alpha == r.alpha)
+                    r.y0 = o++->y0;
+                next.push_back (r);
+            }
+            for (; o != open.cend (); ++o)
+                emit (*o);
+            open.swap (next);
+            next.clear ();
+        }
+        for (auto const& r: open)
+            emit (r);
+
+        ImVec2 white;
+        imgui.igGetFontTexUvWhitePixel (&white);
+        proj.map_to_screen (corners.data (), corners.size (), corners.data ());
+        for (std::size_t k = 0; k < alphas.size (); ++k)
+        {
+            auto n = vertices.size () % (4 * batch);
+            auto const a = corners[2 * k], b = corners[2 * k + 1];
+            auto col = IM_COL32 (0, 0, 0, alphas[k]);
+            vertices.insert (vertices.end (), {
+                    ImDrawVert { ImVec2 { a.x, a.y }, white, col },
+                    ImDrawVert { ImVec2 { b.x, a.y }, white, col },
+                    ImDrawVert { ImVec2 { b.x, b.y }, white, col },
+                    ImDrawVert { ImVec2 { a.x, b.y }, white, col } });
+            indices.insert (indices.end (), {
+                    ImDrawIdx (n), ImDrawIdx (n + 1), ImDrawIdx (n + 2),
+                    ImDrawIdx (n), ImDrawIdx (n + 2), ImDrawIdx (n + 3) });
+        }
+    }
+
+    void draw (ImDrawList* dl, glm::vec2 const& wpos) const
+    {
+        for (std::size_t v = 0, i = 0; v < vertices.size (); v += 4 * batch, i += 6 * batch)
+        {
+            copy_triangles (dl, vertices.data () + v, std::min (4 * batch, vertices.size () - v),
+                    indices.data () + i, std::min (6 * batch, indices.size () - i),
+                    wpos - origin);
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Stamps the points of the track range after the last stamped ones, up to @p count of them.
+/// Returns whether there are more.
+static bool
+stamp_fog_grid (fog_grid& fog, glm::vec2 const& step, std::size_t count)
+{
+    auto const fp = track_range.first.position (), lp = track_range.second.position ();
+    if (fog.first != fp || fog.last >= lp)
+        return false;
+
+    // What to stamp is told apart while reading the track, on this thread, then the rows are
+    // stamped by bands on the workers, each band with the shapes which reach it
+    struct shape
+    {
+        glm::ivec2 a, b;        ///< The disc center is b, when a is nowhere
+        int y0, y1;             ///< Rows spanned, as far as the discover radius
+    };
+    std::vector<shape> shapes;
+    int const r = int (fog.stencil.size () / 2);
+    auto add = [&] (glm::ivec2 const& a, glm::ivec2 const& b)
+    {
+        int lo = a == fog_grid::nowhere ? b.y : std::min (a.y, b.y);
+        int hi = a == fog_grid::nowhere ? b.y : std::max (a.y, b.y);
+        if (hi + r >= 0 && lo - r < fog.resolution)
+            shapes.push_back (shape { a, b, lo - r, hi + r + 1 });
+    };
+
+    float const teleport = fog.teleport;
+    auto it = track_range.first + (fog.last - fp);
+    auto const last = track_range.first + (std::min (lp, fog.last + count) - fp);
+    glm::vec2 prev { std::numeric_limits<float>::quiet_NaN () };
+    if (it != track_range.first)
+        prev = it[-1];
+    for (; it != last; ++it)
+    {
+        glm::vec2 const p = *it;
+        glm::ivec2 const cell (maptrack.game_to_map (p) / step);
+        if (fog.claim (cell))
+            add (fog_grid::nowhere, cell);
+        if (glm::distance2 (prev, p) < teleport * teleport)
+            if (glm::ivec2 const from (maptrack.game_to_map (prev) / step); from != cell)
+                add (from, cell);
+        prev = p;
+    }
+    fog.last = last.position ();
+
+    // A few shapes are not worth waking the workers for
+    constexpr std::size_t shared_shapes = 256;
+    std::size_t const bands = shapes.size () < shared_shapes ? 1 : 2 * workers ().size ();
+    workers ().parallel_for (0, bands, [&] (std::size_t k)
+    {
+        int const y0 = int (fog.resolution * k / bands);
+        int const y1 = int (fog.resolution * (k + 1) / bands);
+        for (auto const& s: shapes)
+        {
+            if (s.y1 <= y0 || s.y0 >= y1)
+                continue;
+            if (s.a == fog_grid::nowhere)
+                fog.disc (s.b, y0, y1);
+            else fog.segment (s.a, s.b, y0, y1);
+        }
+    });
+    return fog.last < lp;
+}
+
+/// Brings the fog of war cells of the track range up to date, returns whether any changed
+
+static bool
+update_fog_grid (fog_grid& fog, glm::vec2 const& step, bool fow_invalidated)
+{
+    // Points stamped at once, and by each step of the job which starts over on a long range. The
+    // job stamps another grid, the former one is drawn until it is done.
+    constexpr std::size_t job_points = 1 << 12;
+    static fog_grid next;
+    static bool next_done = false;
+    bool cells_updated = false;
+    if (next_done)
+    {
+        std::swap (fog, next);
+        next_done = false;
+        cells_updated = true;
+    }
+    bool const rebuilding = maptrack.jobs.pending ("Fog of War");
+    auto const& target = rebuilding ? next : fog;
+
+    // Only the points new to the range uncover more cells, for anything else the fog is put back
+    auto const fp = track_range.first.position (), lp = track_range.second.position ();
+    float const teleport = maptrack.teleport_distance ();
+    if (fow_invalidated || target.resolution != maptrack.fow.resolution
+            || target.teleport != teleport || fp != target.first || lp < target.last
+            || track_range.fog_changed < target.last)
+    {
+        auto alpha = [] (float a) { return std::uint8_t (glm::clamp (a * 255, 0.f, 255.f)); };
+        auto& g = lp - fp > job_points ? next : fog;
+        g.reset (maptrack.fow.resolution, maptrack.fow.discover,
+                alpha (maptrack.fow.default_alpha), alpha (maptrack.fow.tracked_alpha),
+                alpha (maptrack.fow.player_alpha), teleport, fp);
+        if (&g == &next)
+        {
+            maptrack.jobs.submit ("Fog of War", [step] {
+                // The track got shorter under the range, the next frame starts over
+                if (track_range.second.position () > maptrack.track.size ())
+                    return false;
+                if (stamp_fog_grid (next, step, job_points))
+                    return true;
+                next_done = true;
+                return false;
+            });
+        }
+        else
+        {
+            maptrack.jobs.cancel ("Fog of War");
+            cells_updated = true;
+        }
+    }
+    track_range.fog_changed = std::numeric_limits<std::size_t>::max ();
+
+    if (!maptrack.jobs.pending ("Fog of War") && fog.last < lp)
+    {
+        stamp_fog_grid (fog, step, lp - fog.last);
+        cells_updated = true;
+    }
+
+    // Over the track
+    auto player = fog_grid::nowhere;
+    if (glm::all (glm::isfinite (player_location)))
+        player = glm::ivec2 (maptrack.game_to_map (player_location) * float (fog.resolution));
+    if (cells_updated || player != fog.player)
+    {
+        fog.move_player (player);
+        cells_updated = true;
+    }
+    return cells_updated;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -459,90 +1549,112 @@ static void
 draw_fog (glm::vec2 const& wpos, glm::vec2 const& wsz,
           glm::vec2 const& uvtl, glm::vec2 const& uvbr)
 {
-    if (!maptrack.fow.enabled || track_range.first == track_range.second)
+    if (!maptrack.fow.enabled)
+        return;
+    if (!maptrack.fow.persistent && track_range.first == track_range.second)
         return;
 
     static decltype (maptrack.fow) cached = maptrack.fow;
     bool const fow_invalidated =
-               cached.resolution != maptrack.fow.resolution
+               cached.persistent != maptrack.fow.persistent
+            || cached.resolution != maptrack.fow.resolution
             || cached.discover != maptrack.fow.discover
             || cached.default_alpha != maptrack.fow.default_alpha
-            || cached.tracked_alpha != maptrack.fow.tracked_alpha;
+            || cached.tracked_alpha != maptrack.fow.tracked_alpha
+            || cached.player_alpha != maptrack.fow.player_alpha;
     cached = maptrack.fow;
 
-    glm::vec2 const step = 1.f / glm::vec2 (maptrack.fow.resolution, maptrack.fow.resolution);
     map_project const proj (wpos, wsz, uvtl, uvbr);
 
-    static std::vector<char> cells;
-    cells.resize (maptrack.fow.resolution * maptrack.fow.resolution);
-
-    // Update the fog of war cells, reduces comparision time with the tracks down the rendering
-    if (fow_invalidated || track_range.draw_invalidated)
+    // The discovered area comes at the coarsest level which still has a cell per couple of
+    // pixels, the track range at the resolution of the settings. Both opaque outside the map.
+    static fog_grid fog;
+    unsigned level = 0;
+    int resolution = maptrack.fow.resolution;
+    glm::vec2 player { std::numeric_limits<float>::quiet_NaN () };
+    bool cells_updated;
+    if (maptrack.fow.persistent)
     {
-        auto update_cells = [&] (int x, int y, char alpha)
-        {
-            float r2 = maptrack.fow.discover * maptrack.fow.discover;
-            for (int dy = -maptrack.fow.discover; dy <= +maptrack.fow.discover; ++dy)
-                for (int dx = -maptrack.fow.discover; dx <= +maptrack.fow.discover; ++dx)
-                {
-                    if (x+dx >= 0 && x+dx < maptrack.fow.resolution
-                     && y+dy >= 0 && y+dy < maptrack.fow.resolution)
-                    {
-                        if (glm::distance2 (glm::vec2 (x+dx, y+dy), glm::vec2 (x, y)) < r2)
-                            cells[x+dx + (y+dy) * maptrack.fow.resolution] = alpha;
-                    }
-                }
-        };
-
-        char default_alpha = char (glm::clamp (maptrack.fow.default_alpha * 255, 0.f, 255.f));
-        char tracked_alpha = char (glm::clamp (maptrack.fow.tracked_alpha * 255, 0.f, 255.f));
-        char player_alpha = char (glm::clamp (maptrack.fow.player_alpha * 255, 0.f, 255.f));
-
-        std::fill (cells.begin (), cells.end (), default_alpha);
-
-        for (auto it = track_range.first; it != track_range.second; ++it)
+        constexpr float min_pixels = 2;
+        float const max_resolution = std::max (wsz.x / (uvbr.x - uvtl.x),
+                                               wsz.y / (uvbr.y - uvtl.y)) / min_pixels;
+        while (level + 1 < discovery_map::levels
+                && discovery_map::resolution (level) > max_resolution)
+            ++level;
+        resolution = discovery_map::resolution (level);
+
+        auto player_cell = fog_grid::nowhere;
+        if (glm::all (glm::isfinite (player_location)))
         {
-            glm::ivec2 cell (maptrack.game_to_map (*it) / step);
-            update_cells (cell.x, cell.y, tracked_alpha);
+            player = maptrack.game_to_map (player_location) * float (resolution);
+            player_cell = glm::ivec2 (glm::floor (player));
         }
-
-        glm::ivec2 cell (maptrack.game_to_map (player_location) / step);
-        update_cells (cell.x, cell.y, player_alpha);
+        static struct { unsigned level; std::uint64_t revision; glm::ivec2 player; } seen;
+        cells_updated = fow_invalidated || seen.level != level
+            || seen.revision != maptrack.discovered.revision () || seen.player != player_cell;
+        seen = { level, maptrack.discovered.revision (), player_cell };
+    }
+    glm::vec2 step = 1.f / glm::vec2 (resolution, resolution);
+    if (!maptrack.fow.persistent)
+    {
+        // Of another resolution while the one of the settings is being made
+        cells_updated = update_fog_grid (fog, step, fow_invalidated);
+        if (!(resolution = fog.resolution))
+            return;
+        step = 1.f / glm::vec2 (resolution, resolution);
     }
 
-    // Render
-
-    auto wdl = imgui.igGetWindowDrawList ();
-    imgui.ImDrawList_PushClipRect (wdl, to_ImVec2 (wpos), to_ImVec2 (wpos + wsz), false);
-    auto old_flags = std::exchange (wdl->Flags, ImDrawListFlags_None);
-
-    glm::ivec2 const ctl (glm::floor (uvtl / step));
-    glm::vec2 const tl = glm::vec2 (ctl) * step;
-    glm::vec2 const br = glm::vec2 (glm::ceil (uvbr / step)) * step;
+    // Render, the cells in view merged into rectangles only when they or the view change
 
-    glm::ivec2 cell = ctl;
-    for (float y = tl.y; y < br.y; y += step.y, ++cell.y)
+    static struct
+    {
+        glm::vec2 wpos, wsz, uvtl, uvbr;
+        fog_mesh mesh;
+    }
+    view = {};
+    static recorded_layer layer ("Fog of War");
+    bool const rebuilt = cells_updated
+        || view.wsz != wsz || view.uvtl != uvtl || view.uvbr != uvbr;
+    if (rebuilt)
     {
-        cell.x = ctl.x;
-        for (float x = tl.x; x < br.x; x += step.x, ++cell.x)
+        view.wsz = wsz, view.uvtl = uvtl, view.uvbr = uvbr;
+        glm::ivec2 const lo (glm::floor (uvtl / step)), hi (glm::ceil (uvbr / step));
+        if (maptrack.fow.persistent)
         {
-            char alpha = 255;
-            if (cell.x >= 0 && cell.x < maptrack.fow.resolution
-             && cell.y >= 0 && cell.y < maptrack.fow.resolution)
-            {
-                alpha = cells[cell.x + cell.y * maptrack.fow.resolution];
-            }
-            imgui.ImDrawList_AddQuadFilled (wdl,
-                    to_ImVec2 (proj (glm::vec2 (x       , y    ))),
-                    to_ImVec2 (proj (glm::vec2 (x+step.x, y    ))),
-                    to_ImVec2 (proj (glm::vec2 (x+step.x, y+step.y))),
-                    to_ImVec2 (proj (glm::vec2 (x       , y+step.y))),
-                    IM_COL32 (0, 0, 0, alpha));
+            // Around the player as with the track, though the radius is in the finest cells
+            float const r = maptrack.fow.discover * float (discovery_map::size)
+                          / maptrack.fow.resolution / float (1 << level);
+            auto alpha = [] (float a) { return std::uint8_t (glm::clamp (a * 255, 0.f, 255.f)); };
+            auto const default_alpha = alpha (maptrack.fow.default_alpha);
+            auto const tracked_alpha = alpha (maptrack.fow.tracked_alpha);
+            auto const player_alpha = alpha (maptrack.fow.player_alpha);
+            view.mesh.build ([&] (int x, int y) -> std::uint8_t {
+                if (x < 0 || x >= resolution || y < 0 || y >= resolution)
+                    return 255;
+                if (glm::distance2 (glm::vec2 (x, y) + .5f, player) < r * r)
+                    return player_alpha;
+                return maptrack.discovered.test (level, x, y) ? tracked_alpha : default_alpha;
+            }, lo, hi, step, proj, wpos);
         }
+        else view.mesh.build ([&] (int x, int y) -> std::uint8_t {
+                return x < 0 || x >= resolution || y < 0 || y >= resolution ? 255
+                     : fog.cells[x + y * resolution];
+            }, lo, hi, step, proj, wpos);
+        ++fog_cache.rebuilt;
     }
+    else if (view.wpos != wpos)
+        ++fog_cache.moved;
+    else ++fog_cache.reused;
+    view.wpos = wpos;
 
-    wdl->Flags = old_flags;
-    imgui.ImDrawList_PopClipRect (wdl);
+    if (rebuilt || layer.empty ())
+    {
+        auto dl = layer.record (wpos);
+        imgui.ImDrawList_PushClipRect (dl, to_ImVec2 (wpos), to_ImVec2 (wpos + wsz), false);
+        view.mesh.draw (dl, wpos);
+        imgui.ImDrawList_PopClipRect (dl);
+    }
+    layer.splice (imgui.igGetWindowDrawList (), wpos);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -675,6 +1787,7 @@ draw_map (glm::vec2 const& map_pos, glm::vec2 const& map_size)
         mouse_wheel = io->MouseWheel ? (io->MouseWheel > 0 ? +1 : -1) : 0;
     }
 
+    ++map_layers.frames;
     draw_fog         (wpos + map_pos, map_size, uvtl, uvbr);
     draw_icons       (wpos + map_pos, map_size, uvtl, uvbr, hovered);
     draw_track       (wpos + map_pos, map_size, uvtl, uvbr);
@@ -684,19 +1797,55 @@ draw_map (glm::vec2 const& map_pos, glm::vec2 const& map_size)
 
 //--------------------------------------------------------------------------------------------------
 
+/// Moves the window to the ticks [tstart, tend], returns whether it moved or its points changed
+static bool
+update_track_window (track_window& w, std::int64_t tstart, std::int64_t tend)
+{
+    bool tupdated = false;
+    std::size_t changed;
+    std::tie (w.first, w.second)
+        = maptrack.track.time_range (w.view, tstart, tend, tupdated, changed);
+    w.changed = std::min (w.changed, changed);
+    w.fog_changed = std::min (w.fog_changed, changed);
+    w.draw_invalidated |= tupdated;
+    w.length_invalidated |= tupdated;
+    return tupdated;
+}
+
 static void
 update_track_range ()
 {
-    float last_recorded_time = maptrack.track.last_time ();
-    auto track_start2 = std::max (0.f, last_recorded_time - maptrack.last_xdays);
-    auto tstart = menu_since_day ? maptrack.since_dayx : track_start2;
-    auto tend = maptrack.time_point * (last_recorded_time - tstart) + tstart;
+    // In ticks as the track has them, the menu shows the same in float days
+    constexpr auto day = track_block::ticks_per_day;
+    auto const last_recorded = maptrack.track.last_ticks ();
+    auto track_start2 = std::max<std::int64_t> (0, last_recorded - maptrack.last_xdays * day);
+    auto tstart = menu_since_day ? maptrack.since_dayx * day : track_start2;
+    auto tend = tstart + std::llround (maptrack.time_point * double (last_recorded - tstart));
+
+    // Speeds of the former range, which may have been cut short as by a rewind. The summary
+    // starts them over when shown.
+    if (update_track_window (track_range, tstart, tend))
+        maptrack.jobs.cancel ("Track speeds");
+
+    // On its own view, the two windows do not search again for each other
+    if (maptrack.compare.enabled)
+    {
+        if (compare_range.view == track_t::default_view)
+            compare_range.view = maptrack.track.make_view ();
+        auto const length = std::max<std::int64_t> (0, tend - tstart);
+        update_track_window (compare_range, std::max<std::int64_t> (0, tstart - length), tstart);
+    }
+}
 
-    bool tupdated = false;
-    std::tie (track_range.first, track_range.second)
-        = maptrack.track.time_range (tstart, tend, tupdated);
-    track_range.draw_invalidated |= tupdated;
-    track_range.length_invalidated |= tupdated;
+/// For when the points of the track are replaced under the jobs over its range, which are made
+/// again by the next frame which needs them
+static void
+cancel_range_jobs ()
+{
+    maptrack.jobs.cancel ("Track speeds");
+    maptrack.jobs.cancel ("Fog of War");
+    track_range.length_invalidated = true;
+    track_range.fog_changed = 0;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -724,11 +1873,12 @@ render (int active)
     imgui.igPushStyleVar_Float (ImGuiStyleVar_FrameBorderSize, 1.f);
     imgui.igPushStyleVar_Float (ImGuiStyleVar_WindowBorderSize, 0.f);
 
+    // Before any window, as the summary reads the range even while the map one is collapsed
+    update_track_range ();
+
     imgui.igSetNextWindowSize (ImVec2 { 800, 600 }, ImGuiCond_FirstUseEver);
     if (imgui.igBegin ("SSE MapTrack", nullptr, ImGuiWindowFlags_NoScrollbar))
     {
-        update_track_range ();
-
         ImVec2 dragday_size;
         imgui.igCalcTextSize (&dragday_size, "1345", nullptr, false, -1.f);
         auto mapsz = imgui_content_region_avail ();
@@ -774,11 +1924,13 @@ render (int active)
         draw_icons_atlas ();
 
     if (auto f = render_load_tracks.update (tracks_directory); !f.empty ())
-        load_track (tracks_directory / f);
+        load_track_in_steps (tracks_directory / f);
     if (auto f = render_load_icons.update (icons_directory); !f.empty ())
         if (load_icons (icons_directory / f))
             icons_invalidated = true;
 
+    maptrack.jobs.run (maptrack.job_budget * 1e-3);
+
     imgui.igPopStyleVar (4);
     imgui.igPopFont ();
     imgui.igPopStyleColor (9);
@@ -872,12 +2024,58 @@ draw_menu ()
     {
         if (imgui.igButton ("Confirm##clear track", ImVec2 {}))
         {
+            // The discovered area stays, it has a reset of its own. The summary and the jobs
+            // later in this frame read the range.
             maptrack.track.clear ();
+            cancel_range_jobs ();
+            update_track_range ();
             imgui.igCloseCurrentPopup ();
         }
         imgui.igEndPopup ();
     }
 
+    // Timelines left behind by loading older saves
+    auto branches = maptrack.track.branches ();
+    if (branches.size () > 1)
+    {
+        static std::vector<std::string> names;
+        names.clear ();
+        int current = 0;
+        for (auto const& b: branches)
+        {
+            if (b.active)
+                current = int (names.size ());
+            names.push_back ("#" + std::to_string (b.id)
+                    + " day " + std::to_string (int (b.first_time))
+                    + "-" + std::to_string (int (b.last_time))
+                    + ", " + std::to_string (b.size));
+        }
+        bool extract_vector_string (void*, int, const char**);
+        imgui.igSetNextItemWidth (button_size.x * 2);
+        if (imgui.igCombo_FnBoolPtr ("##Branch", &current,
+                    extract_vector_string, &names, int (names.size ()), -1))
+        {
+            maptrack.track.switch_branch (branches[current].id);
+            cancel_range_jobs ();
+            update_track_range ();
+        }
+        imgui.igSameLine (0, -1);
+        if (imgui.igButton ("Prune##track", button_size))
+            imgui.igOpenPopup_Str ("Prune branches?", 0);
+        if (imgui.igBeginPopup ("Prune branches?", 0))
+        {
+            if (imgui.igButton ("Confirm, keep only the current##prune", ImVec2 {}))
+            {
+                for (auto const& b: branches)
+                    if (!b.active)
+                        maptrack.track.prune_branch (b.id);
+                cancel_range_jobs ();
+                imgui.igCloseCurrentPopup ();
+            }
+            imgui.igEndPopup ();
+        }
+    }
+
     imgui.igSeparator ();
     imgui.igText ("Icons - %d instance(s)", int (maptrack.icons.size ()));
     if (imgui.igButton ("Save##icons", button_size))
@@ -963,6 +2161,12 @@ draw_settings ()
         if (imgui.igColorEdit4 ("Color##Track", (float*) &col, cflags))
             maptrack.track_color = imgui.igGetColorU32_Vec4 (col);
         imgui.igSliderFloat ("Width##Track", &maptrack.track_width, 1.f, 20.f, "%.1f", 1);
+        imgui.igCheckbox ("Previous range##Track", &maptrack.compare.enabled);
+        imgui.igSameLine (0, -1);
+        help_marker ("The time range as long just before the selected one, drawn under it.");
+        imgui.igColorConvertU32ToFloat4 (&col, maptrack.compare.color);
+        if (imgui.igColorEdit4 ("Color##Previous", (float*) &col, cflags))
+            maptrack.compare.color = imgui.igGetColorU32_Vec4 (col);
 
         imgui.igText ("");
         imgui.igCheckbox ("Player circle", &maptrack.player.enabled);
@@ -973,10 +2177,58 @@ draw_settings ()
 
         imgui.igText ("");
         imgui.igCheckbox ("Fog of War", &maptrack.fow.enabled);
+        imgui.igCheckbox ("All time discovered##FoW", &maptrack.fow.persistent);
+        imgui.igSameLine (0, -1);
+        if (imgui.igButton ("Clear##FoW", ImVec2 {}))
+            imgui.igOpenPopup_Str ("Clear discovered?", 0);
+        if (imgui.igBeginPopup ("Clear discovered?", 0))
+        {
+            if (imgui.igButton ("Confirm##clear discovered", ImVec2 {}))
+            {
+                maptrack.jobs.cancel ("Discovered area");
+                maptrack.discovered.clear ();
+                imgui.igCloseCurrentPopup ();
+            }
+            imgui.igEndPopup ();
+        }
         imgui.igSliderInt ("Resolution##FoW", &maptrack.fow.resolution, 32, 256, "%d", 0);
         imgui.igSliderInt ("Discover radius##FoW", &maptrack.fow.discover, 1, 8, "%d", 0);
         imgui.igSliderFloat ("Default alpha##FoW", &maptrack.fow.default_alpha, 0, 1, "%.2f", 1);
         imgui.igSliderFloat ("Tracked alpha##FoW", &maptrack.fow.tracked_alpha, 0, 1, "%.2f", 1);
+        if (auto frames = fog_cache.reused + fog_cache.moved + fog_cache.rebuilt)
+        {
+            imgui.igText ("Cache hits: %.1f%% (%llu as is, %llu moved, %llu rebuilt)",
+                    100. * (fog_cache.reused + fog_cache.moved) / frames,
+                    (unsigned long long) fog_cache.reused, (unsigned long long) fog_cache.moved,
+                    (unsigned long long) fog_cache.rebuilt);
+        }
+        if (map_layers.recorded && map_layers.frames)
+        {
+            // A recording replaced by a copy of it, on average
+            auto const reused = map_layers.spliced - map_layers.recorded;
+            auto const saved = double (reused) / map_layers.frames
+                * (map_layers.record_time / map_layers.recorded
+                        - map_layers.splice_time / map_layers.spliced);
+            imgui.igText ("Map layers reused: %.1f%%, %.1f us saved per frame",
+                    100. * reused / map_layers.spliced, saved * 1e6);
+        }
+        for (auto l: recorded_layer::layers ())
+        {
+            if (l->empty ())
+                continue;
+            auto const g = l->last_geometry ();
+            imgui.igText ("%s: %d draw calls, %d vertices, %d triangles, %.1f us per recording",
+                    l->label (), g.draw_calls, g.vertices, g.triangles,
+                    l->mean_record_time () * 1e6);
+        }
+
+        imgui.igText ("");
+        imgui.igSliderFloat ("Background work (ms per frame)", &maptrack.job_budget,
+                .1f, 10.f, "%.1f", 1);
+        imgui.igSliderInt ("Threads for the long loops", &maptrack.worker_threads, 1,
+                std::max (1, int (std::thread::hardware_concurrency ())), "%d", 0);
+        for (auto const& name: maptrack.jobs.names ())
+            imgui.igText ("Working on: %s", name.c_str ());
 
         imgui.igText ("");
         if (imgui.igButton ("Save settings", ImVec2 {}))
@@ -1118,7 +2370,7 @@ draw_track_summary ()
             len = track_t::compute_length (track_range.first, track_range.second);
         imgui.igText ("Length: %.0f", len);
 
-        auto bb = maptrack.track.bounding_box ();
+        auto bb = maptrack.track.bounding_box (track_range.first, track_range.second);
         imgui.igText ("");
         imgui.igText ("Bounding box min: %6.0f %6.0f %6.0f", bb.first.x, bb.first.y, bb.first.z);
         imgui.igText ("Bounding box max: %6.0f %6.0f %6.0f", bb.second.x, bb.second.y, bb.second.z);
@@ -1133,31 +2385,51 @@ draw_track_summary ()
                 int (std::distance (track_range.first, track_range.second)), 0, nullptr,
                 bb.first.z, bb.second.z, avail_sz);
 
-        // Move to track_t?
+        // By a job over the range in parts, the former speeds are shown until it is done
         static float max_speed = 0.f, min_speed = 0.f;
         static std::vector<float> speeds;
         if (track_range.length_invalidated)
         {
-            speeds.clear ();
-            min_speed = max_speed = 0;
-            auto n = std::distance (track_range.first, track_range.second);
-            if (n > 1)
+            struct partial {
+                std::vector<float> speeds;
+                float lo = std::numeric_limits<float>::max (), hi = 0;
+            };
+            auto p = std::make_shared<partial> ();
+            maptrack.jobs.submit ("Track speeds",
+                    [p, first = track_range.first, last = track_range.second] () mutable
             {
-                min_speed = 16'777'216.f;
-                speeds.resize (n - 1);
-                auto out = speeds.begin ();
-                for (auto i = std::next (track_range.first); i != track_range.second; ++i, ++out)
+                // The track got shorter before a frame cancelled it
+                if (last.position () > maptrack.track.size ())
+                    return false;
+
+                // Each step has a part of the points for each thread of the pool
+                std::ptrdiff_t const parts = workers ().size (), job_points = (1 << 14) * parts;
+                auto next = last - first > job_points ? first + job_points : last;
+                auto const part = [&] (std::size_t a, std::size_t b)
                 {
-                    auto i0 = std::prev (i);
-                    int h, h0, m, m0, s, s0;
-                    game_time_hms (i->w, h, m, s);
-                    game_time_hms (i0->w, h0, m0, s0);
-                    float d = glm::distance (i->xyz (), i0->xyz ());
-                    *out = d / (h*3600+m*60+s - h0*3600-m0*60-s0);
-                    max_speed = std::max (max_speed, *out);
-                    min_speed = std::min (min_speed, *out);
-                }
-            }
+                    partial r;
+                    float lo, hi;
+                    track_t::compute_speeds (first + a, first + b + (first + b != last),
+                                             r.speeds, lo, hi);
+                    if (!r.speeds.empty ())
+                        r.lo = lo, r.hi = hi;
+                    return r;
+                };
+                auto const join = [] (partial a, partial b)
+                {
+                    a.speeds.insert (a.speeds.end (), b.speeds.cbegin (), b.speeds.cend ());
+                    a.lo = std::min (a.lo, b.lo), a.hi = std::max (a.hi, b.hi);
+                    return a;
+                };
+                *p = workers ().parallel_reduce (0, next - first, parts, std::move (*p),
+                                                 part, join);
+                if ((first = next) != last)
+                    return true;
+                speeds.swap (p->speeds);
+                min_speed = speeds.empty () ? 0 : p->lo;
+                max_speed = speeds.empty () ? 0 : p->hi;
+                return false;
+            });
         }
         avail_sz.y -= name_asz.y;
         imgui.igText ("");
@@ -0,0 +1,164 @@
+/**
+ * @file slot_map.hpp
+ * @brief Densely stored values, known by handles which survive the changes of the others
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ */
+
+#ifndef SLOT_MAP_HPP
+#define SLOT_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Values in a contiguous array, each one reached through a slot which stays the same as long as
+ * the value lives.
+ *
+ * Erasing moves the last value in the place of the erased one, hence all the operations are
+ * O(1), but the order of the values is not kept. A handle is a slot and the generation of it when
+ * the value was inserted. Every erase bumps the generation of the slot, so handles of erased
+ * values are told apart from the ones of any later value reusing the slot.
+ */
+
+template<class T>
+class slot_map
+{
+public:
+
+    struct handle
+    {
+        std::uint32_t slot = ~std::uint32_t (0);
+        std::uint32_t generation = 0;
+        bool operator== (handle const& h) const
+        {
+            return slot == h.slot && generation == h.generation;
+        }
+        bool operator!= (handle const& h) const { return !(*this == h); }
+    };
+
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    handle insert (T value)
+    {
+        std::uint32_t s;
+        if (free.empty ())
+        {
+            s = std::uint32_t (slots.size ());
+            slots.push_back (entry { 0, 0 });
+        }
+        else
+        {
+            s = free.back ();
+            free.pop_back ();
+        }
+        slots[s].position = std::uint32_t (values.size ());
+        values.push_back (std::move (value));
+        owners.push_back (s);
+        return handle { s, slots[s].generation };
+    }
+
+    /// Does nothing for a handle of no live value
+    void erase (handle const& h)
+    {
+        if (!contains (h))
+            return;
+        auto const p = slots[h.slot].position;
+        if (p + 1 != values.size ())
+        {
+            values[p] = std::move (values.back ());
+            owners[p] = owners.back ();
+            slots[owners[p]].position = p;
+        }
+        values.pop_back ();
+        owners.pop_back ();
+        ++slots[h.slot].generation;
+        free.push_back (h.slot);
+    }
+
+    /// Keeps the slots, so that no handle from before becomes valid again
+    void clear ()
+    {
+        for (auto s: owners)
+        {
+            ++slots[s].generation;
+            free.push_back (s);
+        }
+        values.clear ();
+        owners.clear ();
+    }
+
+    bool contains (handle const& h) const
+    {
+        return h.slot < slots.size () && slots[h.slot].generation == h.generation;
+    }
+
+    /// The handle has to be of a live value
+    T& operator[] (handle const& h) { return values[slots[h.slot].position]; }
+    T const& operator[] (handle const& h) const { return values[slots[h.slot].position]; }
+
+    /// Current handle of a live slot
+    handle at_slot (std::uint32_t s) const { return handle { s, slots[s].generation }; }
+
+    /// Of the value at a position of the contiguous array
+    handle handle_of (std::size_t position) const { return at_slot (owners[position]); }
+
+    /// Upper bound of the slots in use, for arrays on the side indexed by them
+    std::size_t slot_count () const { return slots.size (); }
+
+    std::size_t size () const { return values.size (); }
+    bool empty () const { return values.empty (); }
+
+    iterator begin () { return values.begin (); }
+    iterator end () { return values.end (); }
+    const_iterator begin () const { return values.begin (); }
+    const_iterator end () const { return values.end (); }
+
+    void reserve (std::size_t n)
+    {
+        values.reserve (n);
+        owners.reserve (n);
+    }
+
+private:
+
+    struct entry
+    {
+        std::uint32_t position;     ///< Into #values, while live
+        std::uint32_t generation;
+    };
+
+    std::vector<T> values;
+    std::vector<std::uint32_t> owners;  ///< Slot of each value
+    std::vector<entry> slots;
+    std::vector<std::uint32_t> free;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -0,0 +1,184 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Few worker threads to share loops with
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Fixed set of threads, which together with the calling one run the iterations of a loop.
+ *
+ * A loop returns only when all of its iterations are done, hence whatever they write is there to
+ * read after it, and what they read must not change meanwhile. One loop at a time, from a single
+ * thread. The iterations take any index left, so these should be of about the same work, though
+ * of enough of it to be worth the synchronization.
+ */
+
+class thread_pool
+{
+public:
+
+    /// With @p workers threads, besides the calling one
+    explicit thread_pool (unsigned workers)
+    {
+        for (unsigned k = 0; k < workers; ++k)
+            threads.emplace_back ([this] { work (); });
+    }
+
+    ~thread_pool ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            stopping = true;
+        }
+        wake.notify_all ();
+        for (auto& t: threads)
+            t.join ();
+    }
+
+    thread_pool (thread_pool const&) = delete;
+    thread_pool& operator= (thread_pool const&) = delete;
+
+    /// Threads running a loop, the calling one included
+    std::size_t size () const { return threads.size () + 1; }
+
+    /// Calls f (i) for each i in [first, last)
+    template<class F>
+    void parallel_for (std::size_t first, std::size_t last, F&& f)
+    {
+        if (last <= first)
+            return;
+        if (threads.empty () || last - first == 1)
+        {
+            for (auto i = first; i < last; ++i)
+                f (i);
+            return;
+        }
+
+        std::function<void (std::size_t)> const run = [first, &f] (std::size_t i) {
+            f (first + i);
+        };
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            task = &run;
+            count = last - first;
+            next = 0, left = count;
+            ++generation;
+        }
+        wake.notify_all ();
+        steal (run);
+
+        // The workers which took the loop are let go of it before it is gone
+        std::unique_lock<std::mutex> lock (mutex);
+        done.wait (lock, [this] { return !left && !active; });
+        task = nullptr;
+    }
+
+    /// The partial results of @p parts about equal subranges of [first, last), each one as
+    /// map (begin, end), joined in order to @p init as init = join (move (init), move (part))
+    template<class T, class Map, class Join>
+    T parallel_reduce (std::size_t first, std::size_t last, std::size_t parts, T init,
+                       Map&& map, Join&& join)
+    {
+        parts = std::max<std::size_t> (1, std::min (parts, last - first));
+        std::vector<T> results (parts);
+        parallel_for (0, parts, [&] (std::size_t k) {
+            results[k] = map (first + (last - first) * k / parts,
+                              first + (last - first) * (k + 1) / parts);
+        });
+        for (auto& r: results)
+            init = join (std::move (init), std::move (r));
+        return init;
+    }
+
+private:
+
+    void work ()
+    {
+        std::uint64_t seen = 0;
+        for (;;)
+        {
+            std::function<void (std::size_t)> const* run;
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                wake.wait (lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                if (!(run = task))
+                    continue;
+                ++active;
+            }
+            steal (*run);
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                --active;
+            }
+            done.notify_all ();
+        }
+    }
+
+    /// Iterations until none is left
+    void steal (std::function<void (std::size_t)> const& run)
+    {
+        for (std::size_t i; (i = next++) < count; )
+        {
+            run (i);
+            if (--left == 0)
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                done.notify_all ();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void (std::size_t)> const* task = nullptr;
+    std::size_t count = 0;
+    std::atomic<std::size_t> next {0}, left {0};
+    unsigned active = 0;
+    std::uint64_t generation = 0;
+    bool stopping = false;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
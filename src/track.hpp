@@ -46,22 +46,56 @@
 
 #include <gsl/gsl_assert>
 
+#include "track_store.hpp"
+#include "track_simd.hpp"
+
 #include <vector>
 #include <limits>
 #include <algorithm>
 #include <numeric>
+#include <utility>
+#include <memory>
+#include <cstdint>
 
 //--------------------------------------------------------------------------------------------------
 
-/// Wraps common ops and caches with regard a tracked route
+/**
+ * Wraps common ops and caches with regard a tracked route.
+ *
+ * Loading an older save game rewinds the time. Instead of dropping the points past it, the
+ * current timeline is shelved as a branch and the recording continues on a new one, which shares
+ * the blocks of the common past with it. Any of the branches can be switched back or pruned,
+ * and past #max_shelved of them the oldest ones are pruned on their own.
+ *
+ * Any number of time windows can be kept through #range_view handles, each one caching its own
+ * bounds. Changes of the points invalidate only the windows which reach them.
+ */
 
 class track_t
 {
 public:
 
-    typedef std::vector<glm::vec4>::const_iterator const_iterator;
+    typedef track_store storage_type;
+    typedef storage_type::const_iterator const_iterator;
+
+    static constexpr std::uint32_t no_branch = ~std::uint32_t (0);
 
-    track_t () : merge_distance2 (0)
+    /// Handle of an independently cached time window, see #make_view()
+    typedef std::uint32_t range_view;
+    static constexpr range_view default_view = 0;
+
+    /// Summary of one of the timelines
+    struct branch_info
+    {
+        std::uint32_t id;
+        std::uint32_t parent;   ///< The one it was forked from, or #no_branch
+        std::size_t fork;       ///< Number of points shared with the parent
+        std::size_t size;
+        float first_time, last_time;
+        bool active;
+    };
+
+    track_t () : merge_distance2 (0), views (1)
     {
         clear ();
     }
@@ -75,140 +109,827 @@ public:
     float last_time () const {
         return values.empty () ? 0.f : values.back ().w;
     }
+    std::int64_t last_ticks () const {
+        return values.empty () ? 0 : values.time (values.size () - 1);
+    }
     std::size_t size () const {
         return values.size ();
     }
+    const_iterator begin () const {
+        return values.cbegin ();
+    }
+    const_iterator end () const {
+        return values.cend ();
+    }
     auto bounding_box () const {
-        return values.empty () ? std::make_pair (glm::vec4 {0}, glm::vec4 {0})
-                               : std::make_pair (lo, hi);
+        return values.empty () ? std::make_pair (glm::vec4 {0}, glm::vec4 {0}) : boxes[1];
+    }
+
+    /// Bounds of a subrange: up to two partial blocks through the group boxes (and at most a
+    /// couple of group sizes of points), while the whole blocks in between through the tree.
+    auto bounding_box (const_iterator first, const_iterator last) const
+    {
+        if (first == last)
+            return std::make_pair (glm::vec4 {0}, glm::vec4 {0});
+        auto f = first.position (), l = last.position ();
+        auto b0 = f >> track_block::bits, b1 = (l - 1) >> track_block::bits;
+        if (b0 == b1)
+            return block_box (f, l);
+        auto box = join (block_box (f, (b0 + 1) << track_block::bits),
+                         block_box (b1 << track_block::bits, l));
+        for (auto i = b0 + 1 + leaves, j = b1 + leaves; i < j; i /= 2, j /= 2)
+        {
+            if (i & 1) box = join (box, boxes[i++]);
+            if (j & 1) box = join (box, boxes[--j]);
+        }
+        return box;
     }
 
+    /// Drops all points in all branches
     void clear ()
     {
-        reset_lohi ();
-        invalidate_time_range ();
+        invalidate_views ();
         values.clear ();
+        boxes.assign (2, empty_box ());
+        leaves = 1;
+        shelved.clear ();
+        branch_id = 0, branch_parent = no_branch, branch_fork = 0;
+        next_branch_id = 1;
+    }
+
+    std::uint32_t active_branch () const {
+        return branch_id;
+    }
+
+    std::vector<branch_info> branches () const
+    {
+        auto info = [] (storage_type const& v, std::uint32_t id, std::uint32_t parent,
+                        std::size_t fork, bool active)
+        {
+            return branch_info { id, parent, fork, v.size (),
+                v.empty () ? 0.f : float (track_block::days (v.first_time (0))),
+                v.empty () ? 0.f : v.back ().w, active };
+        };
+        std::vector<branch_info> r;
+        r.push_back (info (values, branch_id, branch_parent, branch_fork, true));
+        for (auto const& b: shelved)
+            r.push_back (info (b.values, b.id, b.parent, b.fork, false));
+        std::sort (r.begin (), r.end (), [] (auto const& a, auto const& b) { return a.id < b.id; });
+        return r;
+    }
+
+    /// Makes another branch the one to be shown and appended to
+    bool switch_branch (std::uint32_t id)
+    {
+        if (id == branch_id)
+            return true;
+        auto it = std::find_if (shelved.begin (), shelved.end (),
+                [id] (auto const& b) { return b.id == id; });
+        if (it == shelved.end ())
+            return false;
+        swap_active (*it);
+        invalidate_views ();
+        return true;
+    }
+
+    /// Drops a shelved branch, its children get attached to its parent
+    bool prune_branch (std::uint32_t id)
+    {
+        auto it = std::find_if (shelved.begin (), shelved.end (),
+                [id] (auto const& b) { return b.id == id; });
+        if (it == shelved.end ())
+            return false;
+        auto reparent = [&it] (std::uint32_t& parent, std::size_t& fork)
+        {
+            if (parent == it->id)
+                parent = it->parent, fork = std::min (fork, it->fork);
+        };
+        reparent (branch_parent, branch_fork);
+        for (auto& b: shelved)
+            reparent (b.parent, b.fork);
+        shelved.erase (it);
+        return true;
     }
 
-    /// Pretty generic way to write a binary blob into stream-like object
+    /**
+     * Pretty generic way to write a binary blob into stream-like object.
+     *
+     * The active branch goes first, in the same layout as before the branches (point count and
+     * interleaved glm::vec4), so older versions still load it. The rest follows as records of
+     * the points which are not shared with one of the branches already written. Since version 2
+     * the exact ticks follow each of the point arrays (the ones of the active branch after the
+     * header), as the glm::vec4 has only the rounded float days.
+     */
     template<class OStream>
     void save_binary (OStream& os)
     {
-        auto size = static_cast<std::uint32_t> (values.size ());
-        os.write (reinterpret_cast<const char*> (&size), sizeof (size));
-        os.write (reinterpret_cast<const char*> (values.data ()), size * sizeof (glm::vec4));
+        write_u32 (os, values.size ());
+        write_points (os, values, 0, values.size ());
+
+        write_u32 (os, branch_tag);
+        write_u32 (os, branch_version);
+        write_u32 (os, shelved.size ());
+        write_u32 (os, branch_id);
+        write_u32 (os, branch_parent);
+        write_u32 (os, branch_fork);
+        write_ticks (os, values, 0, values.size ());
+
+        for (std::size_t k = 0; k < shelved.size (); ++k)
+        {
+            auto const& b = shelved[k];
+            std::size_t ref = 0, base = values.common_prefix (b.values);
+            for (std::size_t j = 0; j < k; ++j)
+                if (auto c = shelved[j].values.common_prefix (b.values); c > base)
+                    ref = j + 1, base = c;
+            write_u32 (os, b.id);
+            write_u32 (os, b.parent);
+            write_u32 (os, b.fork);
+            write_u32 (os, ref);
+            write_u32 (os, base);
+            write_u32 (os, b.values.size () - base);
+            write_points (os, b.values, base, b.values.size ());
+            write_ticks (os, b.values, base, b.values.size ());
+        }
     }
 
-    /// Counterpart of #save_binary()
+    /// Counterpart of #save_binary(), takes also files without branches or ticks, for which the
+    /// float days are converted.
     template<class IStream>
     void load_binary (IStream& is)
     {
-        std::uint32_t size = 0;
-        is.read (reinterpret_cast<char*> (&size), sizeof (size));
-        values.resize (size);
-        is.read (reinterpret_cast<char*> (values.data ()), size * sizeof (glm::vec4));
-        update_lohi ();
-        invalidate_time_range ();
+        load_state state;
+        while (load_step (is, state))
+            ;
+        values.seal ();
+        for (auto& b: shelved)
+            b.values.seal ();
+    }
+
+    /// Where #load_step() is at
+    struct load_state
+    {
+        enum { start, points, probe, ticks, boxes, branch } phase = start;
+        std::size_t count = 0;      ///< Points of the active branch in the file
+        std::size_t next = 0;       ///< First point of the phase yet to be done
+        std::uint32_t version = 0, branches = 0;
+        std::vector<std::uint32_t> order;   ///< Branch ids as these were read
+    };
+
+    /// Part of #load_binary(), reading up to @p budget points of the active branch or a whole
+    /// shelved one, so a job can load a new track in the frames. Returns whether there is more.
+    /// The blocks are left open, for #seal_next().
+    template<class IStream>
+    bool load_step (IStream& is, load_state& s, std::size_t budget = std::size_t (1) << 14)
+    {
+        auto chunk = [&s, budget] (std::size_t n) { return std::min (budget, n - s.next); };
+        switch (s.phase)
+        {
+        case load_state::start:
+            clear ();
+            s.count = read_u32 (is);
+            s.phase = load_state::points;
+            return true;
+
+        case load_state::points:
+            read_points (is, std::min (budget, s.count - values.size ()));
+            if (values.size () == s.count)
+                s.phase = load_state::probe;
+            return true;
+
+        case load_state::probe:
+        {
+            // Older files end here, so the probe for the tag failing past their end is no error
+            auto const state = is.rdstate ();
+            s.version = read_u32 (is) == branch_tag ? read_u32 (is) : 0;
+            if (s.version < 1 || s.version > branch_version)
+            {
+                is.clear (state);
+                s.version = 0, s.phase = load_state::boxes;
+                return true;
+            }
+            s.branches = read_u32 (is);
+            branch_id = read_u32 (is);
+            branch_parent = read_u32 (is);
+            branch_fork = read_u32 (is);
+            next_branch_id = branch_id + 1;
+            s.order.assign (1, branch_id);
+            s.phase = s.version > 1 ? load_state::ticks : load_state::boxes;
+            return true;
+        }
+
+        case load_state::ticks:
+        {
+            auto n = chunk (values.size ());
+            read_ticks (is, s.next, n);
+            if ((s.next += n) == values.size ())
+                s.next = 0, s.phase = load_state::boxes;
+            return true;
+        }
+
+        case load_state::boxes:
+        {
+            auto n = chunk (values.size ());
+            update_boxes (s.next, s.next + n);
+            update_distances (s.next, s.next + n);
+            if ((s.next += n) < values.size ())
+                return true;
+            invalidate_views ();
+            s.phase = load_state::branch;
+            return s.version && s.branches;
+        }
+
+        case load_state::branch:
+        {
+            auto id = read_u32 (is), parent = read_u32 (is), fork = read_u32 (is);
+            auto ref = read_u32 (is), base = read_u32 (is), n = read_u32 (is);
+            if (is && ref < s.order.size () && switch_branch (s.order[ref]))
+            {
+                fork_active (base, id);
+                auto first = values.size ();
+                read_points (is, n);
+                if (s.version > 1)
+                    read_ticks (is, first, n);
+                update_distances (first, values.size ());
+                update_boxes (first, values.size ());
+                branch_parent = parent, branch_fork = fork;
+                next_branch_id = std::max (next_branch_id, id + 1);
+                s.order.push_back (id);
+                if (--s.branches)
+                    return true;
+            }
+            switch_branch (s.order.front ());
+            return false;
+        }
+        }
+        return false;
+    }
+
+    /// Takes the points and the branches of @p o, as loaded apart by #load_step(). The views stay,
+    /// to search again.
+    void assign (track_t&& o)
+    {
+        values = std::move (o.values);
+        boxes = std::move (o.boxes);
+        leaves = o.leaves;
+        shelved = std::move (o.shelved);
+        branch_id = o.branch_id, branch_parent = o.branch_parent, branch_fork = o.branch_fork;
+        next_branch_id = o.next_branch_id;
+        invalidate_views ();
     }
 
     /// Adds new point, eventually overriding the history (for example when a game is loaded)
     void add_point (glm::vec4 const& p)
     {
-        Expects (std::isfinite (p.x) && std::isfinite (p.y)
-              && std::isfinite (p.z) && std::isfinite (p.w));
+        Expects (std::isfinite (p.w));
+        add_point (p.xyz (), track_block::ticks (p.w));
+    }
+
+    /// Same as above, but with the time in ticks
+    void add_point (glm::vec3 const& p, std::int64_t t)
+    {
+        Expects (std::isfinite (p.x) && std::isfinite (p.y) && std::isfinite (p.z));
 
-        if (!values.empty ())
+        auto changed = values.size ();
+        if (!values.empty () && values.time (values.size () - 1) > t)
         {
-            if (values.back ().w > p.w)
+            auto n = values.size (), fork = time_bound<true> (t);
+            if (n > branch_fork)
             {
-                values.erase (std::upper_bound (
-                        values.begin (), values.end (), p.w,
-                        [] (float t, auto const& p) { return t < p.w; }),
-                        values.end ());
-                update_lohi ();
+                fork_active (fork, next_branch_id++);
+                while (shelved.size () > max_shelved)
+                    prune_branch (std::min_element (shelved.begin (), shelved.end (),
+                            [] (auto const& a, auto const& b) { return a.id < b.id; })->id);
             }
-            if (merge_distance2 < glm::distance2 (p.xyz (), values.back ().xyz ()))
-               values.push_back (glm::vec4 {});
-        } else values.push_back (glm::vec4 {});
+            else
+            {
+                values.truncate (fork);
+                branch_fork = std::min (branch_fork, fork);
+                update_boxes (fork, n);
+            }
+            changed = fork;
+        }
+        if (values.empty () || merge_distance2 < glm::distance2 (p, values.back ().xyz ()))
+            values.push_back (p, t);
+        else
+            values.set (values.size () - 1, p, t);
+
+        auto n = values.size ();
+        values.set_distance (n-1, n < 2 ? 0. : values.distance (n-2) + glm::distance (
+                    glm::dvec3 (values.get (n-2).xyz ()), glm::dvec3 (values.get (n-1).xyz ())));
+        if (changed == n - 1)
+            grow_boxes (n - 1);
+        else
+            update_boxes (n - 1, n);
+        invalidate_views (std::min (changed, n - 1));
+    }
+
+    /// Whether some full blocks were left open by #add_point()
+    bool unsealed () const
+    {
+        return values.unsealed () || std::any_of (shelved.begin (), shelved.end (),
+                [] (auto const& b) { return b.values.unsealed (); });
+    }
+
+    /// Packs one of the full blocks #add_point() left open, the active branch first. Returns
+    /// whether any is left, so it fits a job step, as packing is too slow for the timer.
+    bool seal_next ()
+    {
+        if (values.unsealed ())
+            return values.seal_next () || unsealed ();
+        for (auto& b: shelved)
+            if (b.values.unsealed ())
+                return b.values.seal_next () || unsealed ();
+        return false;
+    }
+
+    /// New time window, cached independently from the others. Handles of dropped views are
+    /// reused.
+    range_view make_view ()
+    {
+        auto it = std::find_if (views.begin () + 1, views.end (),
+                [] (auto const& v) { return !v.used; });
+        if (it == views.end ())
+            it = views.emplace (it);
+        *it = view_t {};
+        return range_view (it - views.begin ());
+    }
 
-        values.back () = p;
-        update_lohi (p);
-        invalidate_time_range ();
+    void drop_view (range_view v)
+    {
+        if (v != default_view && v < views.size ())
+            views[v].used = false;
     }
 
-    /// Quick access into subrange of tracked points between a given time range
+    /// Quick access into subrange of tracked points between a given time range, in ticks. The
+    /// bounds are searched again only if the times change, or if points up to the range end were
+    /// changed. The points from index changed onwards may differ since the previous call on this
+    /// view, if none - it is the maximum size_t.
     std::pair<const_iterator, const_iterator>
-    time_range (float t_start, float t_end, bool& updated)
+    time_range (range_view h, std::int64_t ts, std::int64_t te, bool& updated,
+                std::size_t& changed)
     {
-        Expects (std::isfinite (t_start) && std::isfinite (t_end) && t_start <= t_end);
-        updated = false;
+        Expects (ts <= te);
+        Expects (h < views.size () && views[h].used);
 
-        if (time_start != t_start)
+        auto& v = views[h];
+        updated = v.dirty || v.start != ts || v.end != te;
+        if (updated)
         {
-            updated = true;
-            time_start = t_start;
-            time_start_it = std::lower_bound (
-                    values.cbegin (), values.cend (), time_start,
-                    [] (auto const& p, float t) { return p.w < t; });
+            if (v.dirty || v.start != ts)
+                v.first = time_bound<false> (v.start = ts);
+            if (v.dirty || v.end != te)
+                v.last = time_bound<true> (v.end = te);
+            v.dirty = false;
         }
+        changed = std::exchange (v.changed, no_change);
+        return std::make_pair (values.cbegin () + v.first, values.cbegin () + v.last);
+    }
+    /// Same as above, in float days
+    std::pair<const_iterator, const_iterator>
+    time_range (range_view h, float t_start, float t_end, bool& updated, std::size_t& changed)
+    {
+        Expects (std::isfinite (t_start) && std::isfinite (t_end) && t_start <= t_end);
+        return time_range (h, track_block::ticks (t_start), track_block::ticks (t_end),
+                           updated, changed);
+    }
+    std::pair<const_iterator, const_iterator>
+    time_range (range_view h, float t_start, float t_end, bool& updated)
+    {
+        std::size_t changed;
+        return time_range (h, t_start, t_end, updated, changed);
+    }
+    std::pair<const_iterator, const_iterator>
+    time_range (float t_start, float t_end, bool& updated, std::size_t& changed)
+    {
+        return time_range (default_view, t_start, t_end, updated, changed);
+    }
+    std::pair<const_iterator, const_iterator>
+    time_range (float t_start, float t_end, bool& updated)
+    {
+        return time_range (default_view, t_start, t_end, updated);
+    }
+
+    /// Constant time, through the cumulative distance column
+    static double compute_length (const_iterator first, const_iterator last)
+    {
+        if (last - first < 2)
+            return 0;
+        auto const& s = *first.store ();
+        return s.distance (last.position () - 1) - s.distance (first.position ());
+    }
 
-        if (time_end != t_end)
+    /// Coarsest level of detail which stays within a pixel, when a game unit is that many pixels
+    static unsigned lod_level (float pixels_per_unit)
+    {
+        unsigned k = 0;
+        while (k + 1 < track_lod::levels && track_lod::error (k + 1) * pixels_per_unit < 1)
+            ++k;
+        return k;
+    }
+
+    /// Visits the XY of the points in [first, last) kept at a level of detail, which start or end
+    /// a segment that may cross the XY box [lo, hi], as f (glm::vec2 xy, std::size_t position,
+    /// bool joined). The point is joined if the segment from the previously visited one is to be
+    /// drawn. The groups of points, of which the bounds miss the box, are skipped. The open tail
+    /// block has no simplified levels, hence all of its points are taken.
+    template<class F>
+    static void for_each_lod_point (const_iterator first, const_iterator last, unsigned level,
+                                    glm::vec2 const& lo, glm::vec2 const& hi, F&& f)
+    {
+        auto const& s = *first.store ();
+        auto fp = first.position (), lp = last.position ();
+        auto crosses = [&lo, &hi] (glm::vec2 const& a, glm::vec2 const& b)
         {
-            updated = true;
-            time_end = t_end;
-            time_end_it = std::upper_bound (
-                    values.cbegin (), values.cend (), time_end,
-                    [] (float t, auto const& p) { return t < p.w; });
-        }
+            return glm::all (glm::lessThanEqual (glm::min (a, b), hi))
+                && glm::all (glm::lessThanEqual (lo, glm::max (a, b)));
+        };
+
+        // A segment between two points of a block lies in the bounds of the groups from the
+        // one of the first point up to the one of the second, hence the prefix count of those
+        // which cross. Between two blocks, the segment itself is checked.
+        std::uint16_t seen[track_block::groups + 1];
+        std::size_t o = 0, pi = lp;
+        glm::vec2 prev {0};
+        bool joined = false;
+        auto visit = [&] (std::size_t i, glm::vec2 const& p)
+        {
+            if (pi < i)
+            {
+                bool cross = pi < o ? crosses (prev, p)
+                           : seen[((i - o) >> track_block::group_bits) + 1]
+                                != seen[(pi - o) >> track_block::group_bits];
+                if (cross && !joined)
+                    f (prev, pi, false);
+                if (cross)
+                    f (p, i, true);
+                joined = cross;
+            }
+            prev = p, pi = i;
+        };
+
+        for (auto b = fp >> track_block::bits; std::max (fp, b << track_block::bits) < lp; ++b)
+        {
+            o = b << track_block::bits;
+            auto i0 = std::max (fp, o) - o, i1 = std::min (lp - o, track_block::size);
+            auto lod = s.lod (b);
+            auto const* blk = lod ? nullptr : &s.block (b);
+            auto g0 = i0 >> track_block::group_bits, g1 = (i1 + track_block::group_size - 1)
+                                                     >> track_block::group_bits;
+            seen[g0] = 0;
+            for (auto g = g0; g < g1; ++g)
+            {
+                auto r = lod ? lod->bounds[g] : track_lod::group_bounds (*blk, g, s.size () - o);
+                seen[g + 1] = std::uint16_t (seen[g] + crosses (glm::vec2 (r.x, r.y),
+                                                                glm::vec2 (r.z, r.w)));
+            }
 
-        return std::make_pair (time_start_it, time_end_it);
+            if (seen[g1] == seen[g0])
+            {
+                // Only the segments to the neighbour blocks may cross
+                auto end_point = [&] (std::size_t i)
+                {
+                    if (blk) return glm::vec2 (blk->x[i], blk->y[i]);
+                    auto const& l = lod->level[1];
+                    if (i == 0) return l.xy.front ();
+                    if (i == track_block::mask) return l.xy.back ();
+                    return glm::vec2 (s.get (o + i).xy ());
+                };
+                visit (o + i0, end_point (i0));
+                if (i1 - 1 != i0)
+                    visit (o + i1 - 1, end_point (i1 - 1));
+            }
+            else if (!level || !lod)
+            {
+                // The groups which do not cross need only their ends
+                blk = &s.block (b);
+                for (auto i = i0; i < i1; ++i)
+                {
+                    auto g = i >> track_block::group_bits;
+                    auto in = i & (track_block::group_size - 1);
+                    if (seen[g + 1] != seen[g] || !in || in == track_block::group_size - 1
+                            || i == i0 || i == i1 - 1)
+                        visit (o + i, glm::vec2 (blk->x[i], blk->y[i]));
+                }
+            }
+            else
+            {
+                auto const& l = lod->level[level];
+                auto ib = l.index.begin (), ie = l.index.end ();
+                auto k0 = std::lower_bound (ib, ie, i0) - ib;
+                auto k1 = std::lower_bound (ib, ie, i1) - ib;
+                if (l.index[k0] != i0)
+                    visit (o + i0, glm::vec2 (s.get (o + i0).xy ()));
+                for (auto k = k0; k < k1; ++k)
+                    visit (o + l.index[k], l.xy[k]);
+                if (i1 - 1 != (k1 > k0 ? l.index[k1 - 1] : i0))
+                    visit (o + i1 - 1, glm::vec2 (s.get (o + i1 - 1).xy ()));
+            }
+        }
     }
 
-    static double compute_length (const_iterator first, const_iterator last)
+    /// Speed between each of the consecutive points in [first, last), plus its min and max. Reads
+    /// the points without the shared decoding cache, so that parts of a track can be computed on
+    /// many threads at once. The segments of no duration are left out.
+    static void compute_speeds (const_iterator first, const_iterator last,
+                                std::vector<float>& out, float& lo, float& hi)
     {
-        if (first == last)
-            return 0;
-        glm::vec3 p = first->xyz ();
-        return std::accumulate (++first, last, .0, [&p] (auto const& acc, auto const& v)
+        out.clear ();
+        lo = hi = 0;
+        if (last - first < 2)
+            return;
+        out.resize (last - first - 1);
+        lo = max_float, hi = 0;
+        auto o = out.data ();
+        auto const& s = *first.store ();
+        auto scratch = std::make_unique<track_block> ();
+        auto const fp = first.position ();
+        auto const& fb = s.block (fp >> track_block::bits, *scratch);
+        glm::vec3 prev = fb.get (fp & track_block::mask).xyz ();
+        auto prev_time = fb.t[fp & track_block::mask];
+        s.for_each_span (fp + 1, last.position (), *scratch,
+                [&] (track_block const& b, std::size_t k, std::size_t n)
         {
-            auto vp = v.xyz ();
-            return acc + glm::distance (std::exchange (p, vp), vp);
+            if (b.t[k] > prev_time)
+            {
+                *o = glm::distance (prev, b.get (k).xyz ())
+                   / float (double (b.t[k] - prev_time) * track_block::tick_seconds);
+                lo = std::min (lo, *o), hi = std::max (hi, *o);
+                ++o;
+            }
+            o += simd::speeds (b.x + k, b.y + k, b.z + k, b.t + k, track_block::tick_seconds, n,
+                               o, lo, hi);
+            prev = b.get (k + n - 1).xyz (), prev_time = b.t[k + n - 1];
         });
+        out.resize (o - out.data ());
+        if (out.empty ())
+            lo = 0;
     }
 
 private:
 
     static constexpr float max_float =  16'777'216.f,   ///< Some sane limits, because:
                            min_float = -16'777'216.f;   ///< This turns to zero if min limit values
-    static constexpr float nan_float = std::numeric_limits<float>::quiet_NaN ();
+    static constexpr std::int64_t no_time = std::numeric_limits<std::int64_t>::min ();
 
-    std::vector<glm::vec4> values;
+    storage_type values;
     float merge_distance2;
-    float time_start, time_end;
-    const_iterator time_start_it, time_end_it, lenfirst_it, lensecond_it;
-    glm::vec4 lo, hi;
 
-    inline void invalidate_time_range ()
+    /// The cached bounds of a time window, as indices in the active branch
+    struct view_t
+    {
+        std::int64_t start = no_time, end = no_time;
+        std::size_t first = 0, last = 0;
+        std::size_t changed = 0;    ///< Lowest point index written since the last query
+        bool used = true, dirty = true;
+    };
+    static constexpr std::size_t no_change = std::numeric_limits<std::size_t>::max ();
+    std::vector<view_t> views;
+
+    typedef std::pair<glm::vec4, glm::vec4> box_type;
+    std::vector<box_type> boxes;    ///< Segment tree with the bounds of each block in the leaves
+    std::size_t leaves;             ///< Power of two, the first leaf index in #boxes
+
+    std::uint32_t branch_id, branch_parent, next_branch_id;
+    std::size_t branch_fork;
+
+    /// Inactive timelines, the active one is spread in the members above
+    struct branch_t
+    {
+        storage_type values;
+        std::vector<box_type> boxes;
+        std::size_t leaves;
+        std::uint32_t id, parent;
+        std::size_t fork;
+    };
+    std::vector<branch_t> shelved;
+
+    /// Every load of an older save shelves a branch, so past these the oldest ones are pruned
+    static constexpr std::size_t max_shelved = 16;
+
+    static constexpr std::uint32_t branch_tag = 0x48435242; ///< "BRCH"
+    static constexpr std::uint32_t branch_version = 2;
+
+    inline void swap_active (branch_t& b)
+    {
+        std::swap (values, b.values);
+        std::swap (boxes, b.boxes);
+        std::swap (leaves, b.leaves);
+        std::swap (branch_id, b.id);
+        std::swap (branch_parent, b.parent);
+        std::swap (branch_fork, b.fork);
+    }
+
+    /// Shelves the active branch and continues on a new one sharing its first @p n points.
+    /// Copies only the block table and the tree, plus the tail block when written to.
+    inline void fork_active (std::size_t n, std::uint32_t id)
+    {
+        n = std::min (n, values.size ());
+        branch_t b { values.fork (n), boxes, leaves, id, branch_id, n };
+        swap_active (b);
+        auto old_size = b.values.size ();
+        shelved.push_back (std::move (b));
+        update_boxes (n, old_size);
+        invalidate_views ();
+    }
+
+    template<class OStream>
+    static void write_u32 (OStream& os, std::size_t v)
+    {
+        auto u = static_cast<std::uint32_t> (v);
+        os.write (reinterpret_cast<const char*> (&u), sizeof (u));
+    }
+
+    template<class IStream>
+    static std::uint32_t read_u32 (IStream& is)
+    {
+        std::uint32_t u = 0;
+        is.read (reinterpret_cast<char*> (&u), sizeof (u));
+        return is ? u : 0;
+    }
+
+    /// Points are written interleaved as glm::vec4, one block at a time
+    template<class OStream>
+    static void write_points (OStream& os, storage_type const& v, std::size_t f, std::size_t l)
+    {
+        std::vector<glm::vec4> buff (track_block::size);
+        v.for_each_span (f, l, [&] (track_block const& b, std::size_t o, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                buff[i] = b.get (o + i);
+            os.write (reinterpret_cast<const char*> (buff.data ()), n * sizeof (glm::vec4));
+        });
+    }
+
+    /// Appends to the active branch
+    template<class IStream>
+    void read_points (IStream& is, std::size_t count)
+    {
+        std::vector<glm::vec4> buff (track_block::size);
+        values.append_spans (count, [&] (track_block& b, std::size_t o, std::size_t n)
+        {
+            is.read (reinterpret_cast<char*> (buff.data ()), n * sizeof (glm::vec4));
+            for (std::size_t i = 0; i < n; ++i)
+                b.set (o + i, buff[i]);
+        });
+    }
+
+    template<class OStream>
+    static void write_ticks (OStream& os, storage_type const& v, std::size_t f, std::size_t l)
+    {
+        v.for_each_span (f, l, [&] (track_block const& b, std::size_t o, std::size_t n)
+        {
+            os.write (reinterpret_cast<const char*> (b.t + o), n * sizeof (std::int64_t));
+        });
+    }
+
+    /// Overwrites the times of the active branch points [first, first + count)
+    template<class IStream>
+    void read_ticks (IStream& is, std::size_t first, std::size_t count)
+    {
+        values.for_each_mutable_span (first, first + count,
+                [&] (track_block& b, std::size_t o, std::size_t n)
+        {
+            is.read (reinterpret_cast<char*> (b.t + o), n * sizeof (std::int64_t));
+        });
+    }
+
+    /// Points from index @p first changed, the views reaching them have to search again
+    inline void invalidate_views (std::size_t first = 0)
+    {
+        for (auto& v: views)
+        {
+            v.dirty = v.dirty || v.last >= first;
+            v.changed = std::min (v.changed, first);
+        }
+    }
+
+    static inline box_type empty_box ()
     {
-        time_start    = time_end    = nan_float;
-        time_start_it = time_end_it = values.cend ();
+        return std::make_pair (glm::vec4 { max_float }, glm::vec4 { min_float });
+    }
+    static inline box_type join (box_type const& a, box_type const& b)
+    {
+        return std::make_pair (glm::min (a.first, b.first), glm::max (a.second, b.second));
+    }
+
+    /// Points [o, e) of a block, the time of which is sorted
+    static inline box_type scan_box (track_block const& b, std::size_t o, std::size_t e)
+    {
+        auto box = empty_box ();
+        if (o == e)
+            return box;
+        simd::minmax (b.x + o, e - o, box.first.x, box.second.x);
+        simd::minmax (b.y + o, e - o, box.first.y, box.second.y);
+        simd::minmax (b.z + o, e - o, box.first.z, box.second.z);
+        box.first.w = float (track_block::days (b.t[o]));
+        box.second.w = float (track_block::days (b.t[e - 1]));
+        return box;
+    }
+
+    /// Points [f, l) all of which are in the same block
+    inline box_type block_box (std::size_t f, std::size_t l) const
+    {
+        auto const& b = values.block (f >> track_block::bits);
+        auto o = f & track_block::mask, e = o + (l - f);
+        auto g0 = (o + track_block::group_size - 1) >> track_block::group_bits;
+        auto g1 = e >> track_block::group_bits;
+        if (g0 >= g1)
+            return scan_box (b, o, e);
+        auto box = join (scan_box (b, o, g0 << track_block::group_bits),
+                         scan_box (b, g1 << track_block::group_bits, e));
+        for (auto g = g0; g < g1; ++g)
+            box = join (box, std::make_pair (b.lo[g], b.hi[g]));
+        return box;
+    }
+
+    /// Refreshes the group and block bounds for the points which changed from index @p first,
+    /// for the blocks up to where the point @p last was. Blocks past the end are emptied, hence
+    /// @p last is the former size when points were dropped.
+    inline void update_boxes (std::size_t first, std::size_t last)
+    {
+        auto n = values.size ();
+        auto nb = values.block_count ();
+        if (nb > leaves)
+        {
+            auto old = leaves;
+            while (leaves < nb) leaves *= 2;
+            std::vector<box_type> tree (2 * leaves, empty_box ());
+            std::copy_n (boxes.begin () + old, old, tree.begin () + leaves);
+            boxes.swap (tree);
+            for (auto i = leaves - 1; i; --i)
+                boxes[i] = join (boxes[2*i], boxes[2*i+1]);
+        }
+        auto fb = std::min (first, n ? n - 1 : 0) >> track_block::bits;
+        auto lb = (last + track_block::mask) >> track_block::bits;
+        for (auto k = fb; k < lb; ++k)
+        {
+            auto box = empty_box ();
+            if (k < nb)
+            {
+                auto& b = values.mutable_block (k);
+                auto end = std::min (track_block::size, n - (k << track_block::bits));
+                b.update_groups (k == fb ? first & track_block::mask : 0, end);
+                for (std::size_t g = 0; (g << track_block::group_bits) < end; ++g)
+                    box = join (box, std::make_pair (b.lo[g], b.hi[g]));
+            }
+            boxes[leaves + k] = box;
+            for (auto i = (leaves + k) / 2; i; i /= 2)
+                boxes[i] = join (boxes[2*i], boxes[2*i+1]);
+        }
     }
 
-    inline void reset_lohi ()
+    /// Same as above for a single point appended at index @p i, as the bounds only grow then:
+    /// the point is joined to its group, then up the tree, without rescanning anything.
+    inline void grow_boxes (std::size_t i)
     {
-        lo = glm::vec4 { max_float };
-        hi = glm::vec4 { min_float };
+        auto k = i >> track_block::bits;
+        if (k >= leaves)
+            return update_boxes (i, i + 1);
+        auto& b = values.mutable_block (k);
+        auto o = i & track_block::mask, g = o >> track_block::group_bits;
+        auto const p = b.get (o);
+        if (o & (track_block::group_size - 1))
+            b.lo[g] = glm::min (b.lo[g], p), b.hi[g] = glm::max (b.hi[g], p);
+        else
+            b.lo[g] = b.hi[g] = p;
+        auto const box = std::make_pair (p, p);
+        for (auto j = leaves + k; j; j /= 2)
+            boxes[j] = join (boxes[j], box);
     }
-    inline void update_lohi (glm::vec4 const& p)
+
+    /// Recomputes the cumulative distance column of the points [first, last). Each segment is
+    /// taken in double as in #add_point(), so a rewritten range measures the same as appended.
+    inline void update_distances (std::size_t first, std::size_t last)
     {
-        lo = glm::min (lo, p);
-        hi = glm::max (hi, p);
+        if (first >= last)
+            return;
+        double acc = first ? values.distance (first - 1) : 0.;
+        glm::dvec3 prev = values.get (first ? first - 1 : 0).xyz ();
+        values.for_each_mutable_span (first, last,
+                [&] (track_block& b, std::size_t o, std::size_t n)
+        {
+            for (std::size_t i = o; i < o + n; ++i)
+            {
+                glm::dvec3 p = b.get (i).xyz ();
+                b.d[i] = acc += glm::distance (prev, p);
+                prev = p;
+            }
+        });
     }
-    inline void update_lohi ()
+
+    /// Index of the first point with time not less than (if Upper, greater than) @p t. Binary
+    /// search over the time directory of the blocks, then within the block, which is not decoded
+    /// when sealed.
+    template<bool Upper>
+    std::size_t time_bound (std::int64_t t) const
     {
-        reset_lohi ();
-        for (auto const& g: values)
-            update_lohi (g);
+        auto below = [t] (std::int64_t v) { return Upper ? v <= t : v < t; };
+        auto const& dir = values.time_directory ();
+        std::size_t lb = std::partition_point (dir.begin (), dir.end (), below) - dir.begin ();
+        if (!lb)
+            return 0;
+        --lb;
+        return (lb << track_block::bits) + values.count_below<Upper> (lb, t);
     }
 };
 
@@ -0,0 +1,417 @@
+/**
+ * @file track_simd.hpp
+ * @brief Vectorized bulk passes over the track columns
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * Each kernel has a scalar version, an SSE2 one (always there on x86-64) and an AVX2 one picked
+ * at runtime, as the DLL is built without -mavx2. The #simd::active() level can be lowered, which
+ * is handy to compare the paths.
+ */
+
+#ifndef TRACK_SIMD_HPP
+#define TRACK_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define TRACK_SIMD_X86
+#  include <immintrin.h>
+#  define TRACK_SIMD_AVX2 __attribute__ ((target ("avx2,fma")))
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+namespace simd {
+
+enum class level { scalar, sse2, avx2 };
+
+inline level
+detected ()
+{
+#ifdef TRACK_SIMD_X86
+    __builtin_cpu_init ();
+    return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")
+        ? level::avx2 : level::sse2;
+#else
+    return level::scalar;
+#endif
+}
+
+/// The one in use, can be lowered but never raised above #detected()
+inline level&
+active ()
+{
+    static level v = detected ();
+    return v;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace scalar {
+
+inline void
+minmax (float const* p, std::size_t n, float& lo, float& hi)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        lo = std::min (lo, p[i]), hi = std::max (hi, p[i]);
+}
+
+/// Distance over time (integer ticks of @p tick seconds) for each of the n-1 segments, in points
+/// per game second. The segments of no duration, as after a rewind to the same tick, have none
+/// and are skipped. Returns the count of the speeds written.
+inline std::size_t
+speeds (float const* x, float const* y, float const* z, std::int64_t const* t, double tick,
+        std::size_t n, float* out, float& lo, float& hi)
+{
+    std::size_t w = 0;
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        if (t[i] <= t[i-1])
+            continue;
+        float dx = x[i] - x[i-1], dy = y[i] - y[i-1], dz = z[i] - z[i-1];
+        float v = std::sqrt (dx*dx + dy*dy + dz*dz) / float (double (t[i] - t[i-1]) * tick);
+        out[w++] = v;
+        lo = std::min (lo, v), hi = std::max (hi, v);
+    }
+    return w;
+}
+
+/// The n interleaved XY pairs as (ax + mx (x - cx), ay + my (y - cy)), @p out may be @p p. The
+/// center is subtracted first, so that the points near it keep their precision.
+inline void
+affine (float const* p, std::size_t n, float cx, float cy, float mx, float my, float ax, float ay,
+        float* out)
+{
+    for (std::size_t i = 0; i < 2 * n; i += 2)
+    {
+        out[i] = ax + mx * (p[i] - cx);
+        out[i+1] = ay + my * (p[i+1] - cy);
+    }
+}
+
+/// Count of elements less than v (if Equal, less or equal) in a sorted sequence
+template<bool Equal>
+inline std::size_t
+count_below (std::int64_t const* p, std::size_t n, std::int64_t v)
+{
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        c += Equal ? p[i] <= v : p[i] < v;
+    return c;
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#ifdef TRACK_SIMD_X86
+
+namespace sse2 {
+
+inline float
+hmin (__m128 v)
+{
+    v = _mm_min_ps (v, _mm_shuffle_ps (v, v, _MM_SHUFFLE (2, 3, 0, 1)));
+    v = _mm_min_ps (v, _mm_shuffle_ps (v, v, _MM_SHUFFLE (1, 0, 3, 2)));
+    return _mm_cvtss_f32 (v);
+}
+
+inline float
+hmax (__m128 v)
+{
+    v = _mm_max_ps (v, _mm_shuffle_ps (v, v, _MM_SHUFFLE (2, 3, 0, 1)));
+    v = _mm_max_ps (v, _mm_shuffle_ps (v, v, _MM_SHUFFLE (1, 0, 3, 2)));
+    return _mm_cvtss_f32 (v);
+}
+
+inline void
+minmax (float const* p, std::size_t n, float& lo, float& hi)
+{
+    std::size_t i = 0;
+    if (n >= 4)
+    {
+        __m128 l = _mm_set1_ps (lo), h = _mm_set1_ps (hi);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 v = _mm_loadu_ps (p + i);
+            l = _mm_min_ps (l, v), h = _mm_max_ps (h, v);
+        }
+        lo = hmin (l), hi = hmax (h);
+    }
+    scalar::minmax (p + i, n - i, lo, hi);
+}
+
+inline __m128
+segment_distance (float const* x, float const* y, float const* z, std::size_t i)
+{
+    __m128 dx = _mm_sub_ps (_mm_loadu_ps (x + i), _mm_loadu_ps (x + i - 1));
+    __m128 dy = _mm_sub_ps (_mm_loadu_ps (y + i), _mm_loadu_ps (y + i - 1));
+    __m128 dz = _mm_sub_ps (_mm_loadu_ps (z + i), _mm_loadu_ps (z + i - 1));
+    return _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (dx, dx), _mm_mul_ps (dy, dy)),
+                                    _mm_mul_ps (dz, dz)));
+}
+
+/// Exact for values below 2^51, there is no direct conversion before AVX-512
+inline __m128d
+to_double (__m128i v)
+{
+    __m128d magic = _mm_set1_pd (6755399441055744.0);   // 2^52 + 2^51
+    return _mm_sub_pd (_mm_castsi128_pd (_mm_add_epi64 (v, _mm_castpd_si128 (magic))), magic);
+}
+
+/// Durations of the 4 segments ending at the points from i, in seconds
+inline __m128
+durations (std::int64_t const* t, std::size_t i, __m128d tick)
+{
+    auto p = reinterpret_cast<__m128i const*> (t + i);
+    auto q = reinterpret_cast<__m128i const*> (t + i - 1);
+    __m128d a = _mm_mul_pd (to_double (_mm_sub_epi64 (_mm_loadu_si128 (p),
+                                                      _mm_loadu_si128 (q))), tick);
+    __m128d b = _mm_mul_pd (to_double (_mm_sub_epi64 (_mm_loadu_si128 (p + 1),
+                                                      _mm_loadu_si128 (q + 1))), tick);
+    return _mm_movelh_ps (_mm_cvtpd_ps (a), _mm_cvtpd_ps (b));
+}
+
+/// The runs of 4 with a segment of no duration go through the scalar version
+inline std::size_t
+speeds (float const* x, float const* y, float const* z, std::int64_t const* t, double tick,
+        std::size_t n, float* out, float& lo, float& hi)
+{
+    if (n < 2)
+        return 0;
+    std::size_t i = 1, w = 0;
+    __m128 l = _mm_set1_ps (lo), h = _mm_set1_ps (hi);
+    __m128d secs = _mm_set1_pd (tick);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 d = durations (t, i, secs);
+        if (_mm_movemask_ps (_mm_cmple_ps (d, _mm_setzero_ps ())))
+        {
+            w += scalar::speeds (x + i - 1, y + i - 1, z + i - 1, t + i - 1, tick, 5, out + w,
+                                 lo, hi);
+            continue;
+        }
+        __m128 v = _mm_div_ps (segment_distance (x, y, z, i), d);
+        _mm_storeu_ps (out + w, v);
+        w += 4;
+        l = _mm_min_ps (l, v), h = _mm_max_ps (h, v);
+    }
+    lo = std::min (lo, hmin (l)), hi = std::max (hi, hmax (h));
+    return w + scalar::speeds (x + i - 1, y + i - 1, z + i - 1, t + i - 1, tick, n - i + 1,
+                               out + w, lo, hi);
+}
+
+/// Two pairs at a time
+inline void
+affine (float const* p, std::size_t n, float cx, float cy, float mx, float my, float ax, float ay,
+        float* out)
+{
+    std::size_t i = 0;
+    __m128 c = _mm_setr_ps (cx, cy, cx, cy);
+    __m128 m = _mm_setr_ps (mx, my, mx, my), a = _mm_setr_ps (ax, ay, ax, ay);
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_ps (out + 2 * i, _mm_add_ps (a, _mm_mul_ps (m,
+                       _mm_sub_ps (_mm_loadu_ps (p + 2 * i), c))));
+    scalar::affine (p + 2 * i, n - i, cx, cy, mx, my, ax, ay, out + 2 * i);
+}
+
+/// There is no 64 bit compare before SSE4.2
+template<bool Equal>
+inline std::size_t
+count_below (std::int64_t const* p, std::size_t n, std::int64_t v)
+{
+    return scalar::count_below<Equal> (p, n, v);
+}
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace avx2 {
+
+TRACK_SIMD_AVX2 inline void
+minmax (float const* p, std::size_t n, float& lo, float& hi)
+{
+    std::size_t i = 0;
+    if (n >= 8)
+    {
+        __m256 l = _mm256_set1_ps (lo), h = _mm256_set1_ps (hi);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 v = _mm256_loadu_ps (p + i);
+            l = _mm256_min_ps (l, v), h = _mm256_max_ps (h, v);
+        }
+        lo = sse2::hmin (_mm_min_ps (_mm256_castps256_ps128 (l), _mm256_extractf128_ps (l, 1)));
+        hi = sse2::hmax (_mm_max_ps (_mm256_castps256_ps128 (h), _mm256_extractf128_ps (h, 1)));
+    }
+    scalar::minmax (p + i, n - i, lo, hi);
+}
+
+TRACK_SIMD_AVX2 inline __m256
+segment_distance (float const* x, float const* y, float const* z, std::size_t i)
+{
+    __m256 dx = _mm256_sub_ps (_mm256_loadu_ps (x + i), _mm256_loadu_ps (x + i - 1));
+    __m256 dy = _mm256_sub_ps (_mm256_loadu_ps (y + i), _mm256_loadu_ps (y + i - 1));
+    __m256 dz = _mm256_sub_ps (_mm256_loadu_ps (z + i), _mm256_loadu_ps (z + i - 1));
+    return _mm256_sqrt_ps (_mm256_fmadd_ps (dx, dx, _mm256_fmadd_ps (dy, dy,
+                           _mm256_mul_ps (dz, dz))));
+}
+
+TRACK_SIMD_AVX2 inline __m256d
+to_double (__m256i v)
+{
+    __m256d magic = _mm256_set1_pd (6755399441055744.0);
+    return _mm256_sub_pd (_mm256_castsi256_pd (_mm256_add_epi64 (v, _mm256_castpd_si256 (magic))),
+                          magic);
+}
+
+TRACK_SIMD_AVX2 inline __m256
+durations (std::int64_t const* t, std::size_t i, __m256d tick)
+{
+    auto p = reinterpret_cast<__m256i const*> (t + i);
+    auto q = reinterpret_cast<__m256i const*> (t + i - 1);
+    __m256d a = _mm256_mul_pd (to_double (_mm256_sub_epi64 (_mm256_loadu_si256 (p),
+                                                            _mm256_loadu_si256 (q))), tick);
+    __m256d b = _mm256_mul_pd (to_double (_mm256_sub_epi64 (_mm256_loadu_si256 (p + 1),
+                                                            _mm256_loadu_si256 (q + 1))), tick);
+    return _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm256_cvtpd_ps (a)),
+                                 _mm256_cvtpd_ps (b), 1);
+}
+
+TRACK_SIMD_AVX2 inline std::size_t
+speeds (float const* x, float const* y, float const* z, std::int64_t const* t, double tick,
+        std::size_t n, float* out, float& lo, float& hi)
+{
+    if (n < 2)
+        return 0;
+    std::size_t i = 1, w = 0;
+    __m256 l = _mm256_set1_ps (lo), h = _mm256_set1_ps (hi);
+    __m256d secs = _mm256_set1_pd (tick);
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 d = durations (t, i, secs);
+        if (_mm256_movemask_ps (_mm256_cmp_ps (d, _mm256_setzero_ps (), _CMP_LE_OQ)))
+        {
+            w += scalar::speeds (x + i - 1, y + i - 1, z + i - 1, t + i - 1, tick, 9, out + w,
+                                 lo, hi);
+            continue;
+        }
+        __m256 v = _mm256_div_ps (segment_distance (x, y, z, i), d);
+        _mm256_storeu_ps (out + w, v);
+        w += 8;
+        l = _mm256_min_ps (l, v), h = _mm256_max_ps (h, v);
+    }
+    lo = std::min (lo, sse2::hmin (_mm_min_ps (_mm256_castps256_ps128 (l),
+                                               _mm256_extractf128_ps (l, 1))));
+    hi = std::max (hi, sse2::hmax (_mm_max_ps (_mm256_castps256_ps128 (h),
+                                               _mm256_extractf128_ps (h, 1))));
+    return w + scalar::speeds (x + i - 1, y + i - 1, z + i - 1, t + i - 1, tick, n - i + 1,
+                               out + w, lo, hi);
+}
+
+TRACK_SIMD_AVX2 inline void
+affine (float const* p, std::size_t n, float cx, float cy, float mx, float my, float ax, float ay,
+        float* out)
+{
+    std::size_t i = 0;
+    __m256 c = _mm256_setr_ps (cx, cy, cx, cy, cx, cy, cx, cy);
+    __m256 m = _mm256_setr_ps (mx, my, mx, my, mx, my, mx, my);
+    __m256 a = _mm256_setr_ps (ax, ay, ax, ay, ax, ay, ax, ay);
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_ps (out + 2 * i, _mm256_fmadd_ps (m,
+                          _mm256_sub_ps (_mm256_loadu_ps (p + 2 * i), c), a));
+    scalar::affine (p + 2 * i, n - i, cx, cy, mx, my, ax, ay, out + 2 * i);
+}
+
+template<bool Equal>
+TRACK_SIMD_AVX2 inline std::size_t
+count_below (std::int64_t const* p, std::size_t n, std::int64_t v)
+{
+    std::size_t c = 0, i = 0;
+    __m256i vv = _mm256_set1_epi64x (v);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i e = _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (p + i));
+        __m256i m = Equal ? _mm256_cmpgt_epi64 (e, vv) : _mm256_cmpgt_epi64 (vv, e);
+        c += __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (m)));
+    }
+    if (Equal)
+        c = i - c;
+    return c + scalar::count_below<Equal> (p + i, n - i, v);
+}
+
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+
+#ifdef TRACK_SIMD_X86
+#  define TRACK_SIMD_DISPATCH(fn, ...) \
+    switch (active ()) { \
+        case level::avx2: return avx2::fn (__VA_ARGS__); \
+        case level::sse2: return sse2::fn (__VA_ARGS__); \
+        default:          return scalar::fn (__VA_ARGS__); \
+    }
+#else
+#  define TRACK_SIMD_DISPATCH(fn, ...) return scalar::fn (__VA_ARGS__);
+#endif
+
+inline void
+minmax (float const* p, std::size_t n, float& lo, float& hi)
+{
+    TRACK_SIMD_DISPATCH (minmax, p, n, lo, hi)
+}
+
+inline std::size_t
+speeds (float const* x, float const* y, float const* z, std::int64_t const* t, double tick,
+        std::size_t n, float* out, float& lo, float& hi)
+{
+    TRACK_SIMD_DISPATCH (speeds, x, y, z, t, tick, n, out, lo, hi)
+}
+
+inline void
+affine (float const* p, std::size_t n, float cx, float cy, float mx, float my, float ax, float ay,
+        float* out)
+{
+    TRACK_SIMD_DISPATCH (affine, p, n, cx, cy, mx, my, ax, ay, out)
+}
+
+template<bool Equal>
+inline std::size_t
+count_below (std::int64_t const* p, std::size_t n, std::int64_t v)
+{
+    TRACK_SIMD_DISPATCH (count_below<Equal>, p, n, v)
+}
+
+#undef TRACK_SIMD_DISPATCH
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
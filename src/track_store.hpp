@@ -0,0 +1,765 @@
+/**
+ * @file track_store.hpp
+ * @brief Segmented, never relocating, column storage for the track points
+ * @internal
+ *
+ * This file is part of Skyrim SE Map Tracker mod (aka MapTrack).
+ *
+ *   MapTrack is free software: you can redistribute it and/or modify it
+ *   under the terms of the GNU Lesser General Public License as published
+ *   by the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   MapTrack is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with MapTrack. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @endinternal
+ *
+ * @ingroup Core
+ *
+ * @details
+ * A std::vector doubles and copies everything when full, which for the track means megabytes
+ * moved inside the timer callback. Here the points live in fixed size blocks which are never
+ * moved once allocated, hence appending is O(1) without any big copy. Only the small table of
+ * block pointers may reallocate.
+ *
+ * Inside a block, x, y, z and t are separate aligned columns (structure of arrays), so the bulk
+ * passes in track_simd.hpp load them straight into vector registers. Next to them is the distance
+ * travelled since the first point of the track, in double as it has to stay exact enough over
+ * thousands of game days, so the length of any range is a single subtraction.
+ *
+ * The time is an integer count of game milliseconds (see #track_block::ticks_per_day). The game
+ * gives float days, which can not tell apart a few seconds after a couple of hundred days, so
+ * these are converted only at the interface, get() and set() still take glm::vec4 with days.
+ *
+ * The blocks are reference counted and copied on write, so that a #fork() shares all the full
+ * blocks with the original store. Only the tail block is ever written to, hence at most one
+ * block gets copied per fork.
+ *
+ * A full block is sealed into a #track_pack, which takes around 8 bytes per point instead of 28.
+ * The append which fills a block does not pack it, as that takes longer than a timer tick should:
+ * the full blocks are left open for #seal_next() to pack them one at a time, later, out of the
+ * recording path. For that the coordinates are kept on a fixed point grid of
+ * #track_block::quantum, so packing them is lossless. Reading a sealed block decodes it into a
+ * small cache of the last used ones, the time span and the bounds of each sealed block are
+ * available without decoding. Even the const access touches the cache, hence a store must not be
+ * read from more than one thread at a time.
+ *
+ * The first times of the blocks are also kept together in a time directory, so the searches by
+ * time walk one small contiguous array before touching a single block.
+ *
+ * For drawing far zoomed out, a sealed block can also carry a #track_lod pyramid. It is made
+ * the first time it is asked for, hence new points never trigger a rebuild of the older ones.
+ */
+
+#ifndef TRACK_STORE_HPP
+#define TRACK_STORE_HPP
+
+#ifndef GLM_FORCE_CXX14
+#define GLM_FORCE_CXX14
+#endif
+
+#ifndef GLM_FORCE_SWIZZLE
+#define GLM_FORCE_SWIZZLE
+#endif
+
+#include <glm/glm.hpp>
+
+#include "track_simd.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+//--------------------------------------------------------------------------------------------------
+
+struct track_block
+{
+    static constexpr unsigned bits = 12;
+    static constexpr std::size_t size = std::size_t (1) << bits;
+    static constexpr std::size_t mask = size - 1;
+    static constexpr unsigned group_bits = 6;
+    static constexpr std::size_t group_size = std::size_t (1) << group_bits;
+    static constexpr std::size_t groups = size / group_size;
+
+    alignas (32) float x[size];
+    alignas (32) float y[size];
+    alignas (32) float z[size];
+    alignas (32) std::int64_t t[size];  ///< Game time in ticks
+    alignas (32) double d[size];    ///< Cumulative distance since the track start
+    glm::vec4 lo[groups], hi[groups];   ///< Bounding box of each group of points
+
+    static constexpr float scale = 16;              ///< Grid steps per game unit
+    static constexpr float quantum = 1 / scale;     ///< Resolution of the stored coordinates
+    static constexpr float limit = 16'777'216.f;    ///< Coordinates are clamped in it
+
+    /// Nearest grid value, exact in float and as 32 bit integer of quanta
+    static float snap (float v) {
+        return std::nearbyint (std::clamp (v, -limit, limit) * scale) * quantum;
+    }
+
+    static constexpr std::int64_t ticks_per_day = 86'400'000;
+    static constexpr double tick_seconds = 86'400. / ticks_per_day;
+
+    /// Exact, as the product of a float and the tick count fits in the double mantissa
+    static std::int64_t ticks (double days) { return std::llround (days * ticks_per_day); }
+    static double days (std::int64_t ticks) { return double (ticks) / ticks_per_day; }
+
+    glm::vec4 get (std::size_t i) const {
+        return glm::vec4 { x[i], y[i], z[i], float (days (t[i])) };
+    }
+    void set (std::size_t i, glm::vec4 const& p) { set (i, p.xyz (), ticks (p.w)); }
+    void set (std::size_t i, glm::vec3 const& p, std::int64_t time) {
+        x[i] = snap (p.x), y[i] = snap (p.y), z[i] = snap (p.z), t[i] = time;
+    }
+
+    /// Recomputes the bounds of the groups from the one with point @p first, up to point @p end.
+    /// The time is sorted, hence its bounds are the first and the last point.
+    void update_groups (std::size_t first, std::size_t end)
+    {
+        for (auto g = first >> group_bits; (g << group_bits) < end; ++g)
+        {
+            auto o = g << group_bits, n = std::min (end, o + group_size) - o;
+            lo[g] = hi[g] = get (o);
+            hi[g].w = float (days (t[o + n - 1]));
+            simd::minmax (x + o, n, lo[g].x, hi[g].x);
+            simd::minmax (y + o, n, lo[g].y, hi[g].y);
+            simd::minmax (z + o, n, lo[g].z, hi[g].z);
+        }
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Full block in compact form.
+ *
+ * The coordinates as integer quanta and the time in ticks, each one as zigzag varint of the
+ * difference to the previous point. The distance column and the group bounds are recomputed when
+ * decoding.
+ *
+ * The header keeps also the first time of each group of points and where its varints start, so
+ * a search by time decodes the times of a single group, not the whole block.
+ */
+
+struct track_pack
+{
+    std::int64_t base[4];       ///< First point, quanta and ticks
+    std::int64_t first_time, last_time;
+    glm::vec4 lo, hi;           ///< Bounds of the whole block
+    double base_distance;       ///< Cumulative distance at the first point
+    std::int64_t group_time[track_block::groups];     ///< First time of each group
+    std::uint32_t group_offset[track_block::groups];  ///< Varints of the second point of each
+    std::vector<std::uint8_t> bytes;
+
+    explicit track_pack (track_block const& b)
+    {
+        std::int64_t prev[4];
+        load (b, 0, prev);
+        std::copy_n (prev, 4, base);
+        first_time = b.t[0], last_time = b.t[track_block::mask];
+        base_distance = b.d[0];
+        lo = b.lo[0], hi = b.hi[0];
+        for (std::size_t g = 1; g < track_block::groups; ++g)
+            lo = glm::min (lo, b.lo[g]), hi = glm::max (hi, b.hi[g]);
+
+        static thread_local std::vector<std::uint8_t> buff (track_block::size * 4 * 5);
+        auto o = buff.data ();
+        for (std::size_t i = 1; i < track_block::size; ++i)
+        {
+            if ((i & (track_block::group_size - 1)) == 1)
+            {
+                group_time[i >> track_block::group_bits] = b.t[i - 1];
+                group_offset[i >> track_block::group_bits] = std::uint32_t (o - buff.data ());
+            }
+            std::int64_t v[4];
+            load (b, i, v);
+            for (int k = 0; k < 4; ++k)
+            {
+                auto d = v[k] - prev[k];
+                auto u = (std::uint64_t (d) << 1) ^ std::uint64_t (d >> 63);
+                for (; u >= 0x80; u >>= 7)
+                    *o++ = std::uint8_t (u | 0x80);
+                *o++ = std::uint8_t (u);
+                prev[k] = v[k];
+            }
+        }
+        bytes.assign (buff.data (), o);
+    }
+
+    void decode (track_block& b) const
+    {
+        std::int64_t v[4];
+        std::copy_n (base, 4, v);
+        store (b, 0, v);
+        auto o = bytes.data ();
+        for (std::size_t i = 1; i < track_block::size; ++i)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                auto u = read_varint (o);
+                v[k] += std::int64_t (u >> 1) ^ -std::int64_t (u & 1);
+            }
+            store (b, i, v);
+        }
+        double acc = b.d[0] = base_distance;
+        for (std::size_t i = 1; i < track_block::size; ++i)
+            b.d[i] = acc += glm::distance (glm::dvec3 (b.get (i-1).xyz ()),
+                                           glm::dvec3 (b.get (i).xyz ()));
+        b.update_groups (0, track_block::size);
+    }
+
+    /// Times of the points of group @p g into @p t, skipping the coordinates
+    void group_times (std::size_t g, std::int64_t* t) const
+    {
+        auto o = bytes.data () + group_offset[g];
+        t[0] = group_time[g];
+        for (std::size_t i = 1; i < track_block::group_size; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+                while (*o++ >= 0x80) {}
+            auto u = read_varint (o);
+            t[i] = t[i - 1] + (std::int64_t (u >> 1) ^ -std::int64_t (u & 1));
+        }
+    }
+
+    std::size_t memory () const { return sizeof (*this) + bytes.capacity (); }
+
+private:
+
+    static std::uint64_t read_varint (std::uint8_t const*& o)
+    {
+        std::uint64_t u = 0;
+        for (unsigned s = 0; ; s += 7)
+        {
+            std::uint64_t c = *o++;
+            u |= (c & 0x7f) << s;
+            if (c < 0x80)
+                return u;
+        }
+    }
+
+    static void load (track_block const& b, std::size_t i, std::int64_t* v)
+    {
+        v[0] = std::int64_t (b.x[i] * track_block::scale);
+        v[1] = std::int64_t (b.y[i] * track_block::scale);
+        v[2] = std::int64_t (b.z[i] * track_block::scale);
+        v[3] = b.t[i];
+    }
+    static void store (track_block& b, std::size_t i, std::int64_t const* v)
+    {
+        b.x[i] = float (v[0]) * track_block::quantum;
+        b.y[i] = float (v[1]) * track_block::quantum;
+        b.z[i] = float (v[2]) * track_block::quantum;
+        b.t[i] = v[3];
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Simplified copies of the XY path of a full block, for drawing it far zoomed out.
+ *
+ * Each level is a Douglas-Peucker pass over the points of the previous one (the first over all
+ * points of the block) with twice the tolerance, hence they nest and the distance to the real
+ * path stays below #error(). The block ends are always kept, so the pieces join.
+ */
+
+struct track_lod
+{
+    static constexpr unsigned levels = 8;           ///< Level 0 is the block itself
+    static constexpr float base_tolerance = 32;     ///< Game units, for level 1
+
+    /// Bound of the distance between the level and the real path, in game units
+    static constexpr float error (unsigned level) {
+        return base_tolerance * float ((1u << level) - 1);
+    }
+
+    struct level_t
+    {
+        std::vector<std::uint16_t> index;   ///< Point offsets within the block
+        std::vector<glm::vec2> xy;
+    };
+    level_t level[levels];                  ///< The first one is left empty
+    glm::vec4 bounds[track_block::groups];  ///< Of each group, see #group_bounds()
+
+    /// XY bounds of a group of points together with the first point of the next group, hence
+    /// of each segment which starts in it, as (min x, min y, max x, max y). Only the @p n first
+    /// points of the block are taken.
+    static glm::vec4 group_bounds (track_block const& b, std::size_t g, std::size_t n)
+    {
+        glm::vec2 lo = b.lo[g], hi = b.hi[g];
+        if (auto i = (g + 1) << track_block::group_bits; i < n)
+        {
+            glm::vec2 p (b.x[i], b.y[i]);
+            lo = glm::min (lo, p), hi = glm::max (hi, p);
+        }
+        return glm::vec4 (lo, hi);
+    }
+
+    explicit track_lod (track_block const& b)
+    {
+        for (std::size_t g = 0; g < track_block::groups; ++g)
+            bounds[g] = group_bounds (b, g, track_block::size);
+        level_t all;
+        all.index.resize (track_block::size);
+        all.xy.resize (track_block::size);
+        for (std::size_t i = 0; i < track_block::size; ++i)
+            all.index[i] = std::uint16_t (i), all.xy[i] = glm::vec2 (b.x[i], b.y[i]);
+        simplify (all, base_tolerance, level[1]);
+        for (unsigned k = 2; k < levels; ++k)
+            simplify (level[k-1], base_tolerance * float (1u << (k-1)), level[k]);
+    }
+
+    std::size_t memory () const
+    {
+        auto m = sizeof (*this);
+        for (auto const& l: level)
+            m += l.index.capacity () * sizeof (l.index[0]) + l.xy.capacity () * sizeof (l.xy[0]);
+        return m;
+    }
+
+private:
+
+    static void simplify (level_t const& in, float tolerance, level_t& out)
+    {
+        auto n = in.xy.size ();
+        std::vector<char> keep (n, 0);
+        keep[0] = keep[n - 1] = 1;
+        std::vector<std::pair<std::size_t, std::size_t>> stack { { 0, n - 1 } };
+        float tol2 = tolerance * tolerance;
+        while (!stack.empty ())
+        {
+            auto [a, b] = stack.back ();
+            stack.pop_back ();
+            auto pa = in.xy[a], ab = in.xy[b] - pa;
+            float len2 = glm::dot (ab, ab), inv = len2 > 0 ? 1 / len2 : 0, worst = tol2;
+            std::size_t split = 0;
+            for (auto i = a + 1; i < b; ++i)
+            {
+                auto ap = in.xy[i] - pa;
+                float t = glm::clamp (glm::dot (ap, ab) * inv, 0.f, 1.f);
+                auto d = ap - t * ab;
+                if (float d2 = glm::dot (d, d); d2 > worst)
+                    worst = d2, split = i;
+            }
+            if (split)
+            {
+                keep[split] = 1;
+                stack.emplace_back (a, split);
+                stack.emplace_back (split, b);
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            if (keep[i])
+                out.index.push_back (in.index[i]), out.xy.push_back (in.xy[i]);
+        out.index.shrink_to_fit ();
+        out.xy.shrink_to_fit ();
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Shared between the forks, holds one of the two forms of a block, plus its simplifications
+/// once these were asked for
+struct track_node
+{
+    std::unique_ptr<track_block> block;
+    std::unique_ptr<track_pack> pack;
+    std::unique_ptr<track_lod> lod;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class track_store
+{
+public:
+
+    /// Random access, stores only an index, hence survives appending of new elements. As the
+    /// points are not stored as glm::vec4, dereferencing yields a value, not a reference.
+    class const_iterator
+    {
+        track_store const* owner = nullptr;
+        std::ptrdiff_t index = 0;
+
+        struct arrow_proxy
+        {
+            glm::vec4 v;
+            glm::vec4 const* operator -> () const { return &v; }
+        };
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef glm::vec4 value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef arrow_proxy pointer;
+        typedef glm::vec4 reference;
+
+        const_iterator () = default;
+        const_iterator (track_store const* owner, std::ptrdiff_t index)
+            : owner (owner), index (index) {}
+
+        reference operator * () const { return owner->get (index); }
+        pointer operator -> () const { return arrow_proxy { owner->get (index) }; }
+        reference operator [] (difference_type n) const { return owner->get (index + n); }
+
+        const_iterator& operator ++ () { ++index; return *this; }
+        const_iterator& operator -- () { --index; return *this; }
+        const_iterator operator ++ (int) { auto t = *this; ++index; return t; }
+        const_iterator operator -- (int) { auto t = *this; --index; return t; }
+        const_iterator& operator += (difference_type n) { index += n; return *this; }
+        const_iterator& operator -= (difference_type n) { index -= n; return *this; }
+
+        friend const_iterator operator + (const_iterator a, difference_type n) { return a += n; }
+        friend const_iterator operator + (difference_type n, const_iterator a) { return a += n; }
+        friend const_iterator operator - (const_iterator a, difference_type n) { return a -= n; }
+        friend difference_type operator - (const_iterator const& a, const_iterator const& b) {
+            return a.index - b.index;
+        }
+        friend bool operator == (const_iterator const& a, const_iterator const& b) {
+            return a.index == b.index && a.owner == b.owner;
+        }
+        friend auto operator <=> (const_iterator const& a, const_iterator const& b) {
+            return a.index <=> b.index;
+        }
+
+        track_store const* store () const { return owner; }
+        std::size_t position () const { return std::size_t (index); }
+    };
+
+    track_store () = default;
+    track_store (track_store&&) = default;
+    track_store& operator = (track_store&&) = default;
+
+    std::size_t size () const { return count; }
+    bool empty () const { return !count; }
+
+    glm::vec4 get (std::size_t i) const {
+        return block (i >> track_block::bits).get (i & track_block::mask);
+    }
+    void set (std::size_t i, glm::vec3 const& p, std::int64_t t) {
+        unique (i >> track_block::bits).set (i & track_block::mask, p, t);
+        if (!(i & track_block::mask))
+            directory[i >> track_block::bits] = t;
+    }
+    glm::vec4 back () const { return get (count - 1); }
+    std::int64_t time (std::size_t i) const {
+        return block (i >> track_block::bits).t[i & track_block::mask];
+    }
+    double distance (std::size_t i) const {
+        return block (i >> track_block::bits).d[i & track_block::mask];
+    }
+    void set_distance (std::size_t i, double d) {
+        unique (i >> track_block::bits).d[i & track_block::mask] = d;
+    }
+
+    std::size_t block_count () const { return (count + track_block::mask) >> track_block::bits; }
+
+    /// Decodes a sealed block, the reference stays valid until a few more blocks get decoded
+    track_block const& block (std::size_t b) const {
+        return blocks[b]->block ? *blocks[b]->block : decoded (blocks[b]);
+    }
+    /// Same, but a sealed block is decoded into @p scratch instead of the cache, hence it can be
+    /// called from many threads at once, as long as the store does not change meanwhile
+    track_block const& block (std::size_t b, track_block& scratch) const
+    {
+        if (blocks[b]->block)
+            return *blocks[b]->block;
+        blocks[b]->pack->decode (scratch);
+        return scratch;
+    }
+    /// The times must be changed only through set() or the span visitors, which keep the
+    /// #directory up to date.
+    track_block& mutable_block (std::size_t b) { return unique (b); }
+
+    /// Simplified path of a sealed block, made on the first call. None for the open blocks, as
+    /// those are still changing.
+    track_lod const* lod (std::size_t b) const
+    {
+        auto const& n = blocks[b];
+        if (!n->pack)
+            return nullptr;
+        if (!n->lod)
+            n->lod = std::make_unique<track_lod> (block (b));
+        return n->lod.get ();
+    }
+
+    /// Time of the first point in a block, without touching the block itself
+    std::int64_t first_time (std::size_t b) const { return directory[b]; }
+    std::vector<std::int64_t> const& time_directory () const { return directory; }
+
+    /// Count of the points of block @p b with time less than (if Upper, not greater than) @p t.
+    /// A sealed block is not decoded, nor cached: its header gives the last time, and the first
+    /// time of each group to pick the single group which gets its times decoded.
+    template<bool Upper>
+    std::size_t count_below (std::size_t b, std::int64_t t) const
+    {
+        auto below = [t] (std::int64_t v) { return Upper ? v <= t : v < t; };
+        if (auto const& n = blocks[b]; !n->block)
+        {
+            auto const& p = *n->pack;
+            if (below (p.last_time))
+                return track_block::size;
+            auto g = std::size_t (std::partition_point (p.group_time,
+                        p.group_time + track_block::groups, below) - p.group_time);
+            if (!g--)
+                return 0;
+            std::int64_t ticks[track_block::group_size];
+            p.group_times (g, ticks);
+            return (g << track_block::group_bits)
+                + simd::count_below<Upper> (ticks, track_block::group_size, t);
+        }
+        auto const& k = *blocks[b]->block;
+        std::size_t first = 0;
+        std::size_t last = std::min (track_block::size, count - (b << track_block::bits));
+        while (last - first > 32)
+        {
+            auto m = (first + last) / 2;
+            if (below (k.t[m])) first = m + 1; else last = m;
+        }
+        return first + simd::count_below<Upper> (k.t + first, last - first, t);
+    }
+
+    /// Bytes held by the points, counting also the blocks shared with other forks
+    std::size_t memory () const
+    {
+        auto m = sizeof (*this) + blocks.capacity () * sizeof (blocks[0])
+               + directory.capacity () * sizeof (directory[0]);
+        for (auto const& n: blocks)
+            m += sizeof (*n) + (n->block ? sizeof (track_block) : n->pack->memory ())
+               + (n->lod ? n->lod->memory () : 0);
+        for (auto const& e: cache)
+            m += e.block ? sizeof (track_block) : 0;
+        return m + (spare ? sizeof (track_block) : 0);
+    }
+
+    const_iterator cbegin () const { return const_iterator (this, 0); }
+    const_iterator cend () const { return const_iterator (this, std::ptrdiff_t (count)); }
+    const_iterator begin () const { return cbegin (); }
+    const_iterator end () const { return cend (); }
+
+    /// Never packs, the full blocks are left open for #seal_next()
+    void push_back (glm::vec3 const& p, std::int64_t t)
+    {
+        if ((count >> track_block::bits) == blocks.size ())
+        {
+            blocks.emplace_back (make_node ());
+            directory.emplace_back (t);
+        }
+        set (count++, p, t);
+    }
+
+    /// Packs all the full blocks
+    void seal ()
+    {
+        for (std::size_t b = 0; b < (count >> track_block::bits); ++b)
+            seal (blocks[b]);
+        sealed = count >> track_block::bits;
+    }
+
+    /// Whether some of the blocks before the last point may still be open
+    bool unsealed () const { return sealed < last_block (); }
+
+    /// Packs the oldest block still open before the one of the last point, if any, returns
+    /// whether more are left open. That one stays open even when full, as the next append reads
+    /// the last point.
+    bool seal_next ()
+    {
+        auto const end = last_block ();
+        auto skip = [&] { while (sealed < end && !blocks[sealed]->block) ++sealed; };
+        skip ();
+        if (sealed < end)
+            seal (blocks[sealed++]), skip ();
+        return sealed < end;
+    }
+
+    /// Keeps the first @p n points
+    void truncate (std::size_t n)
+    {
+        count = std::min (n, count);
+        blocks.resize (block_count ());
+        directory.resize (block_count ());
+        sealed = std::min (sealed, count >> track_block::bits);
+    }
+
+    /// New store with the first @p n points, sharing the blocks with this one
+    track_store fork (std::size_t n) const
+    {
+        track_store s;
+        s.count = std::min (n, count);
+        s.blocks.assign (blocks.begin (), blocks.begin () + s.block_count ());
+        s.directory.assign (directory.begin (), directory.begin () + s.block_count ());
+        s.sealed = std::min (sealed, s.count >> track_block::bits);
+        return s;
+    }
+
+    /// Number of leading points which are the same in both stores
+    std::size_t common_prefix (track_store const& other) const
+    {
+        std::size_t n = std::min (count, other.count), b = 0;
+        while ((b << track_block::bits) < n && blocks[b] == other.blocks[b])
+            ++b;
+        std::size_t i = b << track_block::bits;
+        while (i < n && get (i) == other.get (i))
+            ++i;
+        return std::min (i, n);
+    }
+
+    /// Drops the points and the memory held
+    void clear ()
+    {
+        blocks.clear ();
+        directory.clear ();
+        spare.reset ();
+        count = sealed = 0;
+        cache = {};
+    }
+
+    /// Visits the in-block pieces of [first, last) as f (track_block const&, offset, size)
+    template<class F>
+    void for_each_span (std::size_t first, std::size_t last, F&& f) const
+    {
+        while (first < last)
+        {
+            auto o = first & track_block::mask;
+            auto n = std::min (last - first, track_block::size - o);
+            f (block (first >> track_block::bits), o, n);
+            first += n;
+        }
+    }
+
+    /// Same as above, decoding the sealed blocks into @p scratch as block (b, scratch) does
+    template<class F>
+    void for_each_span (std::size_t first, std::size_t last, track_block& scratch, F&& f) const
+    {
+        while (first < last)
+        {
+            auto o = first & track_block::mask;
+            auto n = std::min (last - first, track_block::size - o);
+            f (block (first >> track_block::bits, scratch), o, n);
+            first += n;
+        }
+    }
+
+    /// Same as above, but allows modifications of the points
+    template<class F>
+    void for_each_mutable_span (std::size_t first, std::size_t last, F&& f)
+    {
+        while (first < last)
+        {
+            auto o = first & track_block::mask;
+            auto n = std::min (last - first, track_block::size - o);
+            auto& b = unique (first >> track_block::bits);
+            f (b, o, n);
+            if (!o)
+                directory[first >> track_block::bits] = b.t[0];
+            first += n;
+        }
+    }
+
+    /// Appends @p n points, filled in place block by block through f (track_block&, offset, size)
+    template<class F>
+    void append_spans (std::size_t n, F&& f)
+    {
+        while (n)
+        {
+            if ((count >> track_block::bits) == blocks.size ())
+                blocks.emplace_back (make_node ()), directory.emplace_back ();
+            auto o = count & track_block::mask;
+            auto k = std::min (n, track_block::size - o);
+            auto& b = unique (count >> track_block::bits);
+            f (b, o, k);
+            if (!o)
+                directory[count >> track_block::bits] = b.t[0];
+            count += k, n -= k;
+        }
+    }
+
+private:
+
+    typedef std::shared_ptr<track_node> node_ptr;
+
+    std::vector<node_ptr> blocks;
+    std::vector<std::int64_t> directory;    ///< First time of each block, for the searches
+    std::size_t count = 0;
+    std::size_t sealed = 0;                 ///< Leading blocks known to be packed
+    std::unique_ptr<track_block> spare;     ///< Freed by the last seal, for the next new block
+
+    /// Decoded blocks, holding also their nodes so these are not reused while cached
+    struct cache_entry
+    {
+        node_ptr node;
+        std::unique_ptr<track_block> block;
+        std::uint64_t used = 0;
+    };
+    mutable std::array<cache_entry, 8> cache;
+    mutable std::size_t cache_last = 0;
+    mutable std::uint64_t cache_clock = 0;
+
+    std::size_t last_block () const { return count ? (count - 1) >> track_block::bits : 0; }
+
+    /// Takes the block last freed by #seal(), as a fresh one page faults all over on first use
+    node_ptr make_node ()
+    {
+        auto n = std::make_shared<track_node> ();
+        n->block = spare ? std::move (spare) : std::make_unique<track_block> ();
+        return n;
+    }
+
+    /// The content stays the same, hence also the forks sharing the node can use the packed one
+    void seal (node_ptr const& n)
+    {
+        if (!n->block)
+            return;
+        n->pack = std::make_unique<track_pack> (*n->block);
+        spare = std::move (n->block);
+    }
+
+    track_block const& decoded (node_ptr const& n) const
+    {
+        if (cache[cache_last].node == n)
+            return *cache[cache_last].block;
+        auto it = std::find_if (cache.begin (), cache.end (),
+                [&n] (auto const& e) { return e.node == n; });
+        if (it == cache.end ())
+        {
+            it = std::min_element (cache.begin (), cache.end (),
+                    [] (auto const& a, auto const& b) { return a.used < b.used; });
+            if (!it->block)
+                it->block = std::make_unique<track_block> ();
+            n->pack->decode (*it->block);
+            it->node = n;
+        }
+        it->used = ++cache_clock;
+        cache_last = it - cache.begin ();
+        return *it->block;
+    }
+
+    /// Copy on write, as the block may be shared with other forks. Unpacks sealed blocks.
+    track_block& unique (std::size_t b)
+    {
+        if (blocks[b].use_count () > 1 || !blocks[b]->block)
+        {
+            auto n = std::make_shared<track_node> ();
+            n->block = std::make_unique<track_block> (block (b));
+            blocks[b] = std::move (n);
+            sealed = std::min (sealed, b);
+        }
+        return *blocks[b]->block;
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+
+#endif
+
@@ -171,12 +171,13 @@ obtain_current_cell ()
 
 //--------------------------------------------------------------------------------------------------
 
-float
+/// In days, widened from the float of the game so that it is converted to ticks as it is
+double
 obtain_game_time ()
 {
     float* source = game_epoch.obtain ();
     if (!source || !std::isnormal (*source) || *source < 0)
-        return std::numeric_limits<float>::quiet_NaN ();
+        return std::numeric_limits<double>::quiet_NaN ();
     return *source;
 }
 